@@ -0,0 +1,339 @@
+#include "pch.h"
+#include "arc_length.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using curves::numeric::pi;
+	using curves::numeric::dot;
+
+	const double _x[4] = { 0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+	const double _w[4] = { 0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+
+	double _speed(curves::operator_t type, const curves::baked_form& k, double t) noexcept
+	{
+		double d[3];
+		curves::combine(type, k, -std::sin(t), std::cos(t), 1.0, d[0], d[1], d[2]);
+		return std::sqrt(dot(d, d));
+	}
+
+	double _gauss(curves::operator_t type, const curves::baked_form& k, double a, double b) noexcept
+	{
+		double mid = 0.5 * (a + b), half = 0.5 * (b - a), sum = 0.0;
+		for (std::size_t i = 0; i < 4; ++i)
+			sum += _w[i] * (_speed(type, k, mid - half * _x[i]) + _speed(type, k, mid + half * _x[i]));
+		return sum * half;
+	}
+
+	double _adaptive(curves::operator_t type, const curves::baked_form& k, double a, double b,
+		double whole, unsigned depth) noexcept
+	{
+		double mid = 0.5 * (a + b);
+		double left = _gauss(type, k, a, mid), right = _gauss(type, k, mid, b);
+		if (depth == 0 || std::abs(left + right - whole) <= 1e-13 * std::abs(left + right))
+			return left + right;
+		return _adaptive(type, k, a, mid, left, depth - 1) + _adaptive(type, k, mid, b, right, depth - 1);
+	}
+
+	// Pieces of at most pi / 8 keep the first estimate close before adaptivity starts.
+	double _integrate(curves::operator_t type, const curves::baked_form& k, double a, double b) noexcept
+	{
+		std::size_t pieces = static_cast<std::size_t>(std::ceil(std::abs(b - a) / (pi / 8.0)));
+		double h = (b - a) / static_cast<double>(std::max<std::size_t>(pieces, 1)), sum = 0.0;
+		for (std::size_t i = 0; i < std::max<std::size_t>(pieces, 1); ++i)
+		{
+			double u = a + h * static_cast<double>(i), v = i + 1 == pieces ? b : u + h;
+			sum += _adaptive(type, k, u, v, _gauss(type, k, u, v), 24);
+		}
+		return sum;
+	}
+}
+
+bool curves::constant_speed(const baked_form& k, double& speed) noexcept
+{
+	double A = dot(k.a, k.a), B = dot(k.b, k.b), C = dot(k.c, k.c);
+	double scale = A + B, tolerance = 1e-12;
+	if (scale == 0.0)
+	{
+		speed = std::sqrt(C);
+		return true;
+	}
+	if (std::abs(A - B) > tolerance * scale || std::abs(dot(k.a, k.b)) > tolerance * scale
+		|| std::abs(dot(k.a, k.c)) > tolerance * std::sqrt(scale * C)
+		|| std::abs(dot(k.b, k.c)) > tolerance * std::sqrt(scale * C))
+		return false;
+	speed = std::sqrt(0.5 * scale + C);
+	return true;
+}
+
+double curves::speed_period(const baked_form& k) noexcept
+{
+	double scale = std::sqrt((dot(k.a, k.a) + dot(k.b, k.b)) * dot(k.c, k.c)), tolerance = 1e-12;
+	if (std::abs(dot(k.a, k.c)) <= tolerance * scale && std::abs(dot(k.b, k.c)) <= tolerance * scale)
+		return pi;
+	return 2.0 * pi;
+}
+
+double curves::arc_length(const interface_curve& curve, double t0, double t1) noexcept
+{ return arc_length(curve.get_operator_type(), curve.get_baked_form(), t0, t1); }
+
+double curves::arc_length(operator_t type, const baked_form& k, double t0, double t1) noexcept
+{
+	double speed;
+	if (constant_speed(k, speed))
+		return speed * (t1 - t0);
+	double period = speed_period(k);
+	double periods = std::floor((t1 - t0) / period);
+	if (periods < 1.0)
+		return t1 >= t0 ? _integrate(type, k, t0, t1) : -arc_length(type, k, t1, t0);
+	double start = t0 + periods * period;
+	return periods * _integrate(type, k, 0.0, period) + _integrate(type, k, start, t1);
+}
+
+void curves::arc_lengths(const curve_collection& collection, double t0, double t1, double* lengths)
+{
+	const curve_collection::circle_bucket& circles = collection.circles();
+	const curve_collection::ellipse_bucket& ellipses = collection.ellipses();
+	const curve_collection::helix_bucket& helices = collection.helices();
+	const std::ptrdiff_t nc = static_cast<std::ptrdiff_t>(circles.id.size());
+	const std::ptrdiff_t ne = static_cast<std::ptrdiff_t>(ellipses.id.size());
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(collection.size());
+	#pragma omp parallel for schedule(dynamic, 256)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		if (i < nc)
+			lengths[i] = arc_length(circles.op_type[i], circles.baked[i], t0, t1);
+		else if (i < nc + ne)
+			lengths[i] = arc_length(ellipses.op_type[i - nc], ellipses.baked[i - nc], t0, t1);
+		else
+			lengths[i] = arc_length(helices.op_type[i - nc - ne], helices.baked[i - nc - ne], t0, t1);
+	}
+}
+
+curves::arc_length_table::arc_length_table(const interface_curve& curve, std::size_t nodes)
+	: arc_length_table(curve.get_operator_type(), curve.get_baked_form(), nodes) {}
+
+curves::arc_length_table::arc_length_table(operator_t type, const baked_form& k, std::size_t nodes)
+	: _type(type), _k(k), _period(speed_period(k)), _cumulative(std::max<std::size_t>(nodes, 1) + 1, 0.0),
+	_speed(_cumulative.size()), _refined(_cumulative.size() - 1)
+{
+	_step = _period / static_cast<double>(_cumulative.size() - 1);
+	for (std::size_t i = 0; i < _speed.size(); ++i)
+		_speed[i] = ::_speed(_type, _k, _step * static_cast<double>(i));
+	for (std::size_t i = 1; i < _cumulative.size(); ++i)
+	{
+		double a = _step * static_cast<double>(i - 1), b = _step * static_cast<double>(i);
+		double whole = _gauss(_type, _k, a, b), length = _adaptive(_type, _k, a, b, whole, 24);
+		_cumulative[i] = _cumulative[i - 1] + length;
+		_refined[i - 1] = std::abs(length - whole) > 1e-14 * length;
+	}
+	_period_length = _cumulative.back();
+}
+
+double curves::arc_length_table::operator()(double t) const noexcept
+{
+	double periods = std::floor(t / _period);
+	double r = t - periods * _period;
+	std::size_t i = std::min(static_cast<std::size_t>(r / _step), _cumulative.size() - 2);
+	double node = _step * static_cast<double>(i), part = _gauss(_type, _k, node, r);
+	if (_refined[i])
+		part = _adaptive(_type, _k, node, r, part, 24);
+	return periods * _period_length + _cumulative[i] + part;
+}
+
+double curves::arc_length_table::_solve(double s) const noexcept
+{
+	if (_period_length == 0.0)
+		return 0.0;
+	double periods = std::floor(s / _period_length);
+	double r = s - periods * _period_length;
+	std::size_t i = static_cast<std::size_t>(std::upper_bound(_cumulative.begin(), _cumulative.end(), r)
+		- _cumulative.begin());
+	i = std::min(std::max<std::size_t>(i, 1), _cumulative.size() - 1) - 1;
+
+	double h = _cumulative[i + 1] - _cumulative[i];
+	double lo = periods * _period + _step * static_cast<double>(i), t = lo;
+	if (h > 0.0)
+	{
+		double u = (r - _cumulative[i]) / h, u2 = u * u, u3 = u2 * u;
+		double m0 = _speed[i] > 0.0 ? h / _speed[i] : _step, m1 = _speed[i + 1] > 0.0 ? h / _speed[i + 1] : _step;
+		t += std::min(std::max((-2.0 * u3 + 3.0 * u2) * _step + (u3 - 2.0 * u2 + u) * m0 + (u3 - u2) * m1, 0.0), _step);
+	}
+	double step;
+	t = numeric::newton([this, s](double u, double& slope)
+	{
+		slope = ::_speed(_type, _k, u);
+		return (*this)(u) - s;
+	}, t, lo, lo + _step, step);
+	return t + step;
+}
+
+double curves::arc_length_table::parameter(double s) const noexcept { return _solve(s); }
+
+namespace
+{
+	// Position, first and second derivative at t from its cosine and sine.
+	struct _state
+	{
+		double t, c, s, v, inverse, dv;
+		double p[3], d[3], dd[3];
+
+		void set(curves::operator_t type, const curves::baked_form& k, double u, double cu, double su) noexcept
+		{
+			t = u;
+			c = cu;
+			s = su;
+			curves::combine(type, k, c, s, t, p[0], p[1], p[2]);
+			curves::combine(type, k, -s, c, 1.0, d[0], d[1], d[2]);
+			curves::combine(type, k, -c, -s, 0.0, dd[0], dd[1], dd[2]);
+			v = std::sqrt(dot(d, d));
+			inverse = v > 0.0 ? 1.0 / v : 0.0;
+			dv = dot(d, dd) * inverse;
+		}
+
+		// First-order move by a parameter change small enough for its square to vanish.
+		void nudge(double e) noexcept
+		{
+			t += e;
+			double cn = c - e * s;
+			s += e * c;
+			c = cn;
+			for (std::size_t j = 0; j < 3; ++j)
+			{
+				p[j] += e * d[j];
+				d[j] += e * dd[j];
+			}
+			v += e * dv;
+		}
+	};
+
+	// Cosine and sine of t + delta from those of t: a series below 1e-2, where its error is under
+	// rounding, the library functions beyond.
+	void _rotate(double c, double s, double t, double delta, double& cd, double& sd) noexcept
+	{
+		if (std::abs(delta) < 1e-2)
+		{
+			double d2 = delta * delta;
+			double cr = 1.0 - d2 * (0.5 - d2 * (1.0 / 24.0 - d2 / 720.0));
+			double sr = delta * (1.0 - d2 * (1.0 / 6.0 - d2 / 120.0));
+			cd = c * cr - s * sr;
+			sd = s * cr + c * sr;
+		}
+		else
+		{
+			cd = std::cos(t + delta);
+			sd = std::sin(t + delta);
+		}
+	}
+
+	constexpr std::size_t _anchor = 64;
+
+	// Largest step, as a fraction of the scale v / |P''| on which the speed changes, that the
+	// three-point rule below integrates to about 1e-14 of its length.
+	constexpr double _reach = 0.1;
+
+	// Largest Newton correction applied to first order; its square times |P''| is then below
+	// rounding of the position. Larger ones move the point exactly and are corrected again.
+	constexpr double _nudge = 1e-8;
+}
+
+// Dense samples walk from point to point: a second-order step in s, cosine and sine advanced
+// by rotation through the step, the length of the step from the three-point rule with
+// end-derivative correction (error O(h^7)), and Newton corrections onto the target whose
+// length is carried on to the next step. Steps that would leave the node interval they start
+// in or outrun the scale of the speed, every _anchor-th point, and spacings wider than the
+// smallest table interval take the parameter from _solve instead.
+template <typename _store>
+void curves::arc_length_table::_sample(double t0, double t1, std::size_t n,
+	double* t, const _store& store) const noexcept
+{
+	if (n == 0)
+		return;
+	double s0 = (*this)(t0), ds = n > 1 ? ((*this)(t1) - s0) / static_cast<double>(n - 1) : 0.0;
+	double narrowest = HUGE_VAL;
+	for (std::size_t i = 0; i + 1 < _cumulative.size(); ++i)
+		narrowest = std::min(narrowest, _cumulative[i + 1] - _cumulative[i]);
+	bool dense = std::abs(ds) < narrowest;
+
+	_state a;
+	a.set(_type, _k, t0, std::cos(t0), std::sin(t0));
+	double length = s0;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		double target = s0 + ds * static_cast<double>(i);
+		bool solve = i != 0 && i + 1 != n && (!dense || i % _anchor == 0 || a.v == 0.0);
+		if (i + 1 == n && i != 0)
+		{
+			a.set(_type, _k, t1, std::cos(t1), std::sin(t1));
+			length = target;
+		}
+		else if (i != 0 && !solve)
+		{
+			double step = target - length, inverse3 = a.inverse * a.inverse * a.inverse;
+			double delta = step * a.inverse - 0.5 * step * step * a.dv * inverse3;
+			double lo = std::floor(a.t / _period) * _period;
+			lo += std::min(std::floor((a.t - lo) / _step), static_cast<double>(_cumulative.size() - 2)) * _step;
+			double u = a.t + delta;
+			if (!(u >= lo && u <= lo + _step) || std::abs(delta) * std::sqrt(dot(a.dd, a.dd)) > _reach * a.v)
+				solve = true;
+			else
+			{
+				double cm, sm, cu, su, dm[3];
+				_rotate(a.c, a.s, a.t, 0.5 * delta, cm, sm);
+				_rotate(a.c, a.s, a.t, delta, cu, su);
+				combine(_type, _k, -sm, cm, 1.0, dm[0], dm[1], dm[2]);
+				_state b;
+				b.set(_type, _k, u, cu, su);
+				double h = b.t - a.t;
+				double reached = length + h / 30.0 * (7.0 * (a.v + b.v) + 16.0 * std::sqrt(dot(dm, dm)))
+					+ h * h / 60.0 * (a.dv - b.dv);
+				double e = (target - reached) * b.inverse;
+				for (std::size_t k = 0; k < 4 && std::abs(e) >= _nudge; ++k)
+				{
+					double v = b.v, dv = b.dv;
+					_rotate(b.c, b.s, b.t, e, cu, su);
+					b.set(_type, _k, b.t + e, cu, su);
+					reached += 0.5 * e * (v + b.v) + e * e / 12.0 * (dv - b.dv);
+					e = (target - reached) * b.inverse;
+				}
+				length = reached + e * b.v + 0.5 * e * e * b.dv;
+				b.nudge(e);
+				a = b;
+			}
+		}
+		if (solve)
+		{
+			double u = _solve(target);
+			a.set(_type, _k, u, std::cos(u), std::sin(u));
+			length = target;
+		}
+		store(i, a);
+		if (t != nullptr)
+			t[i] = a.t;
+	}
+}
+
+void curves::arc_length_table::sample_equidistant(double t0, double t1, std::size_t n,
+	curve_point* values, double* t) const noexcept
+{
+	_sample(t0, t1, n, t, [values](std::size_t i, const _state& a)
+	{ values[i] = curve_point(a.p[0], a.p[1], a.p[2]); });
+}
+
+void curves::arc_length_table::sample_equidistant(double t0, double t1, std::size_t n,
+	double* x, double* y, double* z, double* t) const noexcept
+{
+	_sample(t0, t1, n, t, [x, y, z](std::size_t i, const _state& a)
+	{
+		x[i] = a.p[0];
+		y[i] = a.p[1];
+		z[i] = a.p[2];
+	});
+}
+
+void curves::sample_equidistant(const interface_curve& curve, double t0, double t1, std::size_t n,
+	curve_point* values, double* t)
+{ arc_length_table(curve).sample_equidistant(t0, t1, n, values, t); }
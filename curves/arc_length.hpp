@@ -0,0 +1,70 @@
+#ifndef _CAD_ARC_LENGTH
+#define _CAD_ARC_LENGTH
+
+#include <vector>
+
+#include "collection.hpp"
+
+namespace curves
+{
+	// |P'(t)|^2 = (a.a) sin^2 + (b.b) cos^2 + c.c - 2 (a.b) sin cos - 2 (a.c) sin + 2 (b.c) cos.
+	// The speed is constant when |a| = |b| and a, b, c are mutually orthogonal: every circle and
+	// helix under a similarity operator. It is pi-periodic when c is orthogonal to a and b,
+	// 2 pi-periodic otherwise.
+	DLL_API bool constant_speed(const baked_form& k, double& speed) noexcept;
+	DLL_API double speed_period(const baked_form& k) noexcept;
+
+	// Signed length of P over [t0, t1]: closed form at constant speed, otherwise whole periods
+	// times the length of one period plus adaptive Gauss-Legendre on the remainder.
+	DLL_API double arc_length(const interface_curve& curve, double t0, double t1) noexcept;
+	DLL_API double arc_length(operator_t type, const baked_form& k, double t0, double t1) noexcept;
+
+	// lengths[i] for every curve of the collection in bucket order, in parallel.
+	DLL_API void arc_lengths(const curve_collection& collection, double t0, double t1, double* lengths);
+
+	DLL_API void sample_equidistant(const interface_curve& curve, double t0, double t1, std::size_t n,
+		curve_point* values, double* t = nullptr);
+
+	// Cumulative length over one period of the speed at uniform nodes. A query costs one table
+	// lookup and an 8-point Gauss-Legendre rule over the part of a node interval; intervals that
+	// one rule does not resolve to 1e-14, around the sharp speed minima of flat ellipses, are
+	// marked and integrated adaptively instead.
+	class arc_length_table final
+	{
+		operator_t _type;
+		baked_form _k;
+		double _period, _step, _period_length;
+		std::vector<double> _cumulative, _speed;
+		std::vector<bool> _refined;
+
+		double _solve(double s) const noexcept;
+		template <typename _store>
+		void _sample(double t0, double t1, std::size_t n, double* t, const _store& store) const noexcept;
+	public:
+		static constexpr std::size_t default_nodes = 64;
+
+		DLL_API explicit arc_length_table(const interface_curve& curve, std::size_t nodes = default_nodes);
+		DLL_API arc_length_table(operator_t type, const baked_form& k, std::size_t nodes = default_nodes);
+
+		double period() const noexcept { return _period; }
+		double period_length() const noexcept { return _period_length; }
+
+		// length from 0 to t, negative for t < 0
+		DLL_API double operator()(double t) const noexcept;
+		double length(double t0, double t1) const noexcept { return (*this)(t1) - (*this)(t0); }
+
+		// Inverse of operator(): a cubic Hermite guess from the nodes (dt/ds = 1 / speed) refined
+		// by Newton steps on operator(), bracketed by the node interval that holds s, down to
+		// rounding. A curve of zero length maps every s to 0.
+		DLL_API double parameter(double s) const noexcept;
+
+		// n points equally spaced in length over [t0, t1], both ends included; t may be null.
+		// Dense spacings cost about one cosine and sine per point.
+		DLL_API void sample_equidistant(double t0, double t1, std::size_t n,
+			curve_point* values, double* t = nullptr) const noexcept;
+		DLL_API void sample_equidistant(double t0, double t1, std::size_t n,
+			double* x, double* y, double* z, double* t = nullptr) const noexcept;
+	};
+}
+
+#endif
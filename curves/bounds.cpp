@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "bounds.hpp"
+#include "numeric.hpp"
+
+namespace
+{
+	using curves::numeric::two_pi;
+
+	void _axis(double a, double b, double c, double t0, double t1, double& lo, double& hi) noexcept
+	{
+		auto f = [a, b, c](double t) { return a * std::cos(t) + b * std::sin(t) + c * t; };
+		double R = std::hypot(a, b);
+		if (c == 0.0 && t1 - t0 >= two_pi)
+		{
+			lo = -R;
+			hi = R;
+			return;
+		}
+		lo = std::min(f(t0), f(t1));
+		hi = std::max(f(t0), f(t1));
+		if (R == 0.0 || std::abs(c) > R)
+			return;
+		double theta = std::atan2(a, b), phi = std::acos(-c / R);
+		for (double root : { phi - theta, -phi - theta })
+		{
+			double first = std::ceil((t0 - root) / two_pi), last = std::floor((t1 - root) / two_pi);
+			for (double m : { first, last })
+			{
+				double t = root + two_pi * m;
+				if (first <= last && t >= t0 && t <= t1)
+				{
+					lo = std::min(lo, f(t));
+					hi = std::max(hi, f(t));
+				}
+			}
+		}
+	}
+}
+
+curves::aabb curves::bounds(const baked_form& k, double t0, double t1) noexcept
+{
+	if (t1 < t0)
+		std::swap(t0, t1);
+	aabb result;
+	for (std::size_t i = 0; i < 3; ++i)
+		_axis(k.a[i], k.b[i], k.c[i], t0, t1, result.min[i], result.max[i]);
+	return result;
+}
+
+curves::aabb curves::bounds(const interface_curve& curve) noexcept
+{ return bounds(curve.get_baked_form(), 0.0, two_pi); }
+
+curves::aabb curves::bounds(const interface_curve& curve, double t0, double t1) noexcept
+{ return bounds(curve.get_baked_form(), t0, t1); }
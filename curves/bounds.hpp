@@ -0,0 +1,104 @@
+#ifndef _CAD_BOUNDS
+#define _CAD_BOUNDS
+
+#include <cmath>
+#include <algorithm>
+
+#include "curves.hpp"
+
+namespace curves
+{
+	struct aabb
+	{
+		double min[3], max[3];
+
+		static aabb empty() noexcept
+		{
+			const double inf = HUGE_VAL;
+			return { { inf, inf, inf }, { -inf, -inf, -inf } };
+		}
+
+		void expand(const double* p) noexcept
+		{
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				min[i] = (std::min)(min[i], p[i]);
+				max[i] = (std::max)(max[i], p[i]);
+			}
+		}
+
+		void expand(const aabb& other) noexcept
+		{
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				min[i] = (std::min)(min[i], other.min[i]);
+				max[i] = (std::max)(max[i], other.max[i]);
+			}
+		}
+
+		bool overlaps(const aabb& other) const noexcept
+		{
+			return min[0] <= other.max[0] && other.min[0] <= max[0]
+				&& min[1] <= other.max[1] && other.min[1] <= max[1]
+				&& min[2] <= other.max[2] && other.min[2] <= max[2];
+		}
+
+		// squared distance from p to the box, 0 inside
+		double distance2(const double* p) const noexcept
+		{
+			double result = 0.0;
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				double d = (std::max)((std::max)(min[i] - p[i], p[i] - max[i]), 0.0);
+				result += d * d;
+			}
+			return result;
+		}
+
+		double area() const noexcept
+		{
+			double dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+			return dx < 0.0 ? 0.0 : 2.0 * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+
+	// Convex region bounded by planes; a point p is inside when
+	// plane[i][0] * x + plane[i][1] * y + plane[i][2] * z + plane[i][3] >= 0 for every i.
+	struct frustum
+	{
+		double plane[6][4];
+
+		// false only when the box lies entirely outside one of the planes
+		bool overlaps(const aabb& box) const noexcept
+		{
+			for (std::size_t i = 0; i < 6; ++i)
+			{
+				const double* n = plane[i];
+				double x = n[0] >= 0.0 ? box.max[0] : box.min[0];
+				double y = n[1] >= 0.0 ? box.max[1] : box.min[1];
+				double z = n[2] >= 0.0 ? box.max[2] : box.min[2];
+				if (n[0] * x + n[1] * y + n[2] * z + n[3] < 0.0)
+					return false;
+			}
+			return true;
+		}
+	};
+
+	// Points origin + s * direction, s >= 0; direction need not be of unit length.
+	struct ray
+	{
+		double origin[3], direction[3];
+	};
+
+	// Exact bounds of P(t) = a cos t + b sin t + c t over [t0, t1]. Per axis the extremes are
+	// at the ends or where -a sin t + b cos t + c = 0; both families of roots are 2 pi-periodic
+	// and their values move monotonically by 2 pi c per period, so only the first and last
+	// root of each family in range can be extreme.
+	DLL_API aabb bounds(const baked_form& k, double t0, double t1) noexcept;
+
+	// One turn, t in [0, 2 pi]: the whole curve for circles and ellipses.
+	DLL_API aabb bounds(const interface_curve& curve) noexcept;
+	DLL_API aabb bounds(const interface_curve& curve, double t0, double t1) noexcept;
+}
+
+#endif
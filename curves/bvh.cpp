@@ -0,0 +1,452 @@
+#include "pch.h"
+#include "bvh.hpp"
+#include "numeric.hpp"
+#include "reduce.hpp"
+
+#include <cmath>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+
+namespace
+{
+	constexpr std::size_t _bins = 16;
+	// smallest subtree built on a thread of its own
+	constexpr std::uint32_t _task = 1u << 14;
+	constexpr unsigned _depth = 48;
+	// split keys: the centroid coordinates and the largest half extent, which separates the
+	// nested boxes of curves sharing a center (every curve without a translation is centered
+	// on the origin)
+	constexpr std::size_t _keys = 4;
+
+	// boxes are reordered in place, so each level reads its range sequentially
+	struct _item
+	{
+		curves::aabb box;
+		double key[_keys];
+		std::uint32_t index;
+	};
+
+	// subtree left for the parallel pass: node index, item range and depth
+	struct _range
+	{
+		std::size_t index;
+		std::uint32_t begin, end;
+		unsigned depth;
+	};
+
+	struct _context
+	{
+		std::vector<_item> items;
+		std::atomic<std::size_t> next;
+		// while nonzero, ranges this small are deferred instead of built
+		std::uint32_t defer;
+		std::vector<_range> deferred;
+	};
+
+	// Ray against boxes grown by tolerance: the ray position where a box is entered, 0 when the
+	// origin is inside, HUGE_VAL when missed. A zero direction component gives infinite slabs;
+	// NaN from 0 * inf fails the comparisons and leaves that axis unconstrained.
+	struct _slab
+	{
+		const curves::ray& r;
+		double tolerance, inverse[3];
+
+		_slab(const curves::ray& r, double tolerance) noexcept : r(r), tolerance(tolerance)
+		{
+			for (std::size_t i = 0; i < 3; ++i)
+				inverse[i] = 1.0 / r.direction[i];
+		}
+
+		double enter(const curves::aabb& box) const noexcept
+		{
+			double enter = 0.0, leave = HUGE_VAL;
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				double near = (box.min[i] - tolerance - r.origin[i]) * inverse[i];
+				double far = (box.max[i] + tolerance - r.origin[i]) * inverse[i];
+				if (near > far)
+					std::swap(near, far);
+				enter = near > enter ? near : enter;
+				leave = far < leave ? far : leave;
+			}
+			return enter <= leave ? enter : HUGE_VAL;
+		}
+	};
+
+	void _key(const curves::aabb& box, double* key) noexcept
+	{
+		key[3] = 0.0;
+		for (std::size_t axis = 0; axis < 3; ++axis)
+		{
+			key[axis] = 0.5 * (box.min[axis] + box.max[axis]);
+			key[3] = std::max(key[3], 0.5 * (box.max[axis] - box.min[axis]));
+		}
+	}
+}
+
+curves::bvh::bvh(const aabb* boxes, const curve_id* ids, std::size_t count)
+{
+	if (count == 0)
+		return;
+	_context context;
+	context.items.resize(count);
+	context.next = 1;
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(count);
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		_item& item = context.items[i];
+		item.box = boxes[i];
+		item.index = static_cast<std::uint32_t>(i);
+		_key(boxes[i], item.key);
+	}
+
+	// The top levels are split serially into about four ranges per thread, which are then
+	// built in parallel; OpenMP 2.0 has no tasks.
+	_nodes.resize(2 * count);
+	const std::uint32_t total = static_cast<std::uint32_t>(count);
+	context.defer = std::max(_task, total / static_cast<std::uint32_t>(4 * reduce::threads()));
+	_build(0, 0, total, 0, &context);
+	context.defer = 0;
+	const std::ptrdiff_t ranges = static_cast<std::ptrdiff_t>(context.deferred.size());
+	#pragma omp parallel for schedule(dynamic)
+	for (std::ptrdiff_t i = 0; i < ranges; ++i)
+	{
+		const _range& range = context.deferred[i];
+		_build(range.index, range.begin, range.end, range.depth, &context);
+	}
+	_nodes.resize(context.next);
+	_nodes.shrink_to_fit();
+
+	_boxes.resize(count);
+	_ids.resize(count);
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		_boxes[i] = context.items[i].box;
+		_ids[i] = ids[context.items[i].index];
+	}
+}
+
+curves::bvh::bvh(const curve_collection& collection, double t0, double t1)
+{
+	std::vector<aabb> boxes(collection.size());
+	std::vector<curve_id> ids(collection.size());
+	const std::ptrdiff_t nc = static_cast<std::ptrdiff_t>(collection.size(CIRCLE));
+	const std::ptrdiff_t ne = static_cast<std::ptrdiff_t>(collection.size(ELLIPSE));
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(collection.size());
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		if (i < nc)
+		{
+			boxes[i] = bounds(collection.circles().baked[i], t0, t1);
+			ids[i] = collection.circles().id[i];
+		}
+		else if (i < nc + ne)
+		{
+			boxes[i] = bounds(collection.ellipses().baked[i - nc], t0, t1);
+			ids[i] = collection.ellipses().id[i - nc];
+		}
+		else
+		{
+			boxes[i] = bounds(collection.helices().baked[i - nc - ne], t0, t1);
+			ids[i] = collection.helices().id[i - nc - ne];
+		}
+	}
+	*this = bvh(boxes.data(), ids.data(), boxes.size());
+}
+
+void curves::bvh::_build(std::size_t index, std::uint32_t begin, std::uint32_t end, unsigned depth,
+	void* context_ptr)
+{
+	_context& context = *static_cast<_context*>(context_ptr);
+	if (end - begin <= context.defer)
+	{
+		context.deferred.push_back({ index, begin, end, depth });
+		return;
+	}
+	_item* items = context.items.data();
+
+	node& current = _nodes[index];
+	current.box = aabb::empty();
+	double low[_keys], high[_keys];
+	std::fill(low, low + _keys, HUGE_VAL);
+	std::fill(high, high + _keys, -HUGE_VAL);
+	for (std::uint32_t i = begin; i < end; ++i)
+	{
+		current.box.expand(items[i].box);
+		for (std::size_t j = 0; j < _keys; ++j)
+		{
+			low[j] = std::min(low[j], items[i].key[j]);
+			high[j] = std::max(high[j], items[i].key[j]);
+		}
+	}
+	std::uint32_t count = end - begin;
+	current.first = begin;
+	current.count = count;
+	if (count <= leaf_size)
+		return;
+
+	// binned SAH over the keys with a non-degenerate spread; deep subtrees fall back to median
+	// splits so that the depth, and the traversal stack, stay bounded
+	double best_cost = HUGE_VAL;
+	std::size_t best_axis = _keys, best_split = 0;
+	double scale[_keys];
+	aabb bin_box[_keys][_bins];
+	std::uint32_t bin_count[_keys][_bins] = {};
+	for (std::size_t axis = 0; axis < _keys; ++axis)
+	{
+		scale[axis] = high[axis] > low[axis] && depth < _depth ? _bins / (high[axis] - low[axis]) : 0.0;
+		std::fill(bin_box[axis], bin_box[axis] + _bins, aabb::empty());
+	}
+	if (depth < _depth)
+		for (std::uint32_t i = begin; i < end; ++i)
+		{
+			const aabb& box = items[i].box;
+			const double* k = items[i].key;
+			for (std::size_t axis = 0; axis < _keys; ++axis)
+			{
+				std::size_t b = std::min<std::size_t>(_bins - 1, static_cast<std::size_t>((k[axis] - low[axis]) * scale[axis]));
+				++bin_count[axis][b];
+				bin_box[axis][b].expand(box);
+			}
+		}
+	for (std::size_t axis = 0; axis < _keys; ++axis)
+	{
+		if (scale[axis] == 0.0)
+			continue;
+		double right_area[_bins];
+		std::uint32_t right_count[_bins];
+		aabb right = aabb::empty();
+		std::uint32_t accumulated = 0;
+		for (std::size_t b = _bins - 1; b > 0; --b)
+		{
+			right.expand(bin_box[axis][b]);
+			accumulated += bin_count[axis][b];
+			right_area[b] = right.area();
+			right_count[b] = accumulated;
+		}
+		aabb left = aabb::empty();
+		accumulated = 0;
+		for (std::size_t b = 0; b + 1 < _bins; ++b)
+		{
+			left.expand(bin_box[axis][b]);
+			accumulated += bin_count[axis][b];
+			if (accumulated == 0 || right_count[b + 1] == 0)
+				continue;
+			double cost = left.area() * accumulated + right_area[b + 1] * right_count[b + 1];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	std::uint32_t middle;
+	if (best_axis == _keys)
+	{
+		std::size_t axis = 0;
+		for (std::size_t i = 1; i < _keys; ++i)
+			if (high[i] - low[i] > high[axis] - low[axis])
+				axis = i;
+		middle = begin + count / 2;
+		std::nth_element(items + begin, items + middle, items + end, [axis](const _item& a, const _item& b)
+		{ return a.key[axis] < b.key[axis]; });
+	}
+	else
+	{
+		double area = current.box.area();
+		if (count <= 4 * leaf_size && area > 0.0 && best_cost >= area * count)
+			return;
+		double origin = low[best_axis], factor = scale[best_axis];
+		_item* split = std::partition(items + begin, items + end, [&](const _item& item)
+		{
+			return std::min<std::size_t>(_bins - 1,
+				static_cast<std::size_t>((item.key[best_axis] - origin) * factor)) <= best_split;
+		});
+		middle = static_cast<std::uint32_t>(split - items);
+	}
+
+	std::size_t children = context.next.fetch_add(2);
+	current.first = static_cast<std::uint32_t>(children);
+	current.count = 0;
+	_build(children, begin, middle, depth + 1, context_ptr);
+	_build(children + 1, middle, end, depth + 1, context_ptr);
+}
+
+template <typename _overlaps>
+void curves::bvh::_query(const _overlaps& overlaps, std::vector<curve_id>& result) const
+{
+	if (_nodes.empty())
+		return;
+	std::uint32_t stack[_depth + 40];
+	std::size_t top = 0;
+	stack[top++] = 0;
+	while (top != 0)
+	{
+		const node& current = _nodes[stack[--top]];
+		if (!overlaps(current.box))
+			continue;
+		if (current.count != 0)
+		{
+			for (std::uint32_t i = current.first; i < current.first + current.count; ++i)
+				if (overlaps(_boxes[i]))
+					result.push_back(_ids[i]);
+		}
+		else
+		{
+			stack[top++] = current.first + 1;
+			stack[top++] = current.first;
+		}
+	}
+}
+
+void curves::bvh::query(const aabb& box, std::vector<curve_id>& result) const
+{ _query([&box](const aabb& other) { return box.overlaps(other); }, result); }
+
+void curves::bvh::query(const double* center, double radius, std::vector<curve_id>& result) const
+{
+	double r2 = radius * radius;
+	_query([center, r2](const aabb& other) { return other.distance2(center) <= r2; }, result);
+}
+
+void curves::bvh::query(const frustum& region, std::vector<curve_id>& result) const
+{ _query([&region](const aabb& other) { return region.overlaps(other); }, result); }
+
+void curves::bvh::query(const ray& r, double tolerance, std::vector<curve_id>& result) const
+{
+	_slab slab(r, tolerance);
+	_query([&slab](const aabb& box) { return slab.enter(box) != HUGE_VAL; }, result);
+}
+
+void curves::bvh::query(const ray& r, double tolerance, const std::function<double(curve_id)>& visit) const
+{
+	if (_nodes.empty())
+		return;
+	_slab slab(r, tolerance);
+	double cutoff = HUGE_VAL;
+	auto open = [&cutoff](double enter) { return enter != HUGE_VAL && enter <= cutoff; };
+	std::pair<std::uint32_t, double> stack[_depth + 40];
+	std::size_t top = 0;
+	stack[top++] = { 0, slab.enter(_nodes[0].box) };
+	while (top != 0)
+	{
+		std::pair<std::uint32_t, double> entry = stack[--top];
+		if (!open(entry.second))
+			continue;
+		const node& current = _nodes[entry.first];
+		if (current.count != 0)
+		{
+			for (std::uint32_t i = current.first; i < current.first + current.count; ++i)
+				if (open(slab.enter(_boxes[i])))
+					cutoff = visit(_ids[i]);
+			continue;
+		}
+		std::uint32_t first = current.first, second = current.first + 1;
+		double near = slab.enter(_nodes[first].box), far = slab.enter(_nodes[second].box);
+		if (far < near)
+		{
+			std::swap(near, far);
+			std::swap(first, second);
+		}
+		if (open(far))
+			stack[top++] = { second, far };
+		if (open(near))
+			stack[top++] = { first, near };
+	}
+}
+
+void curves::bvh::number_boxes() noexcept
+{
+	for (std::size_t i = 0; i < _ids.size(); ++i)
+		_ids[i] = i;
+}
+
+void curves::split_arcs(const curve_collection& collection, double t0, double t1, double step, double margin,
+	std::vector<arc>& arcs, std::vector<aabb>& boxes)
+{
+	if (!(step > 0.0))
+		throw curve_builder::build_exception("Arc step is not valid");
+	if (t1 < t0)
+		std::swap(t0, t1);
+	// every curve of a bucket is cut alike
+	const double closed = std::min(t1 - t0, numeric::two_pi), open = t1 - t0;
+	const std::size_t nc = collection.size(CIRCLE), ne = collection.size(ELLIPSE), nh = collection.size(HELIX);
+	const std::size_t pc = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(closed / step)), 1);
+	const std::size_t ph = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(open / step)), 1);
+	arcs.resize((nc + ne) * pc + nh * ph);
+	boxes.resize(arcs.size());
+
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(collection.size());
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		std::size_t index = static_cast<std::size_t>(i), first, pieces;
+		const baked_form* k;
+		curve_id id;
+		if (index < nc)
+		{
+			k = &collection.circles().baked[index];
+			id = collection.circles().id[index];
+			first = index * pc;
+			pieces = pc;
+		}
+		else if (index < nc + ne)
+		{
+			k = &collection.ellipses().baked[index - nc];
+			id = collection.ellipses().id[index - nc];
+			first = index * pc;
+			pieces = pc;
+		}
+		else
+		{
+			k = &collection.helices().baked[index - nc - ne];
+			id = collection.helices().id[index - nc - ne];
+			first = (nc + ne) * pc + (index - nc - ne) * ph;
+			pieces = ph;
+		}
+		double span = index < nc + ne ? closed : open, h = span / static_cast<double>(pieces);
+		double aa = numeric::dot(k->a, k->a), bb = numeric::dot(k->b, k->b), ab = numeric::dot(k->a, k->b);
+		double major = std::sqrt(0.5 * (aa + bb) + std::hypot(0.5 * (aa - bb), ab));
+		for (std::size_t j = 0; j < pieces; ++j)
+		{
+			double a = t0 + h * static_cast<double>(j), b = j + 1 == pieces ? t0 + span : a + h;
+			arc& part = arcs[first + j];
+			part.id = id;
+			part.t0 = a;
+			part.t1 = b;
+			part.reach = 0.125 * (b - a) * (b - a) * major;
+			combine(GENERAL, *k, std::cos(a), std::sin(a), a, part.p[0], part.p[1], part.p[2]);
+			combine(GENERAL, *k, std::cos(b), std::sin(b), b, part.q[0], part.q[1], part.q[2]);
+			aabb& box = boxes[first + j];
+			box = bounds(*k, a, b);
+			for (std::size_t axis = 0; axis < 3; ++axis)
+			{
+				box.min[axis] -= margin;
+				box.max[axis] += margin;
+			}
+		}
+	}
+}
+
+curves::arc_tree::arc_tree(const curve_collection& collection, double t0, double t1, double step)
+{
+	std::vector<arc> arcs;
+	std::vector<aabb> boxes;
+	split_arcs(collection, t0, t1, step, 0.0, arcs, boxes);
+	std::vector<curve_id> indices(arcs.size());
+	for (std::size_t i = 0; i < indices.size(); ++i)
+		indices[i] = i;
+	_tree = bvh(boxes.data(), indices.data(), boxes.size());
+	// the arcs a query reaches lie together, like their boxes
+	_arcs.resize(arcs.size());
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(arcs.size());
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+		_arcs[i] = arcs[_tree.id(static_cast<std::size_t>(i))];
+	_tree.number_boxes();
+}
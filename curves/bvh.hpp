@@ -0,0 +1,94 @@
+#ifndef _CAD_BVH
+#define _CAD_BVH
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "bounds.hpp"
+#include "collection.hpp"
+
+namespace curves
+{
+	// Bounding-volume hierarchy over curve boxes, split by the surface area heuristic evaluated
+	// on 16 bins per key: the three centroid coordinates and the box size. The top levels are
+	// split serially into a few subtrees per thread, which are then built in parallel.
+	// Queries test node boxes, then every curve box of the leaves reached, and append the ids
+	// whose box overlaps; the curve itself may still miss the query region.
+	class bvh final
+	{
+	public:
+		struct node
+		{
+			aabb box;
+			// leaf: curves [first, first + count); inner node (count == 0): children first, first + 1
+			std::uint32_t first, count;
+		};
+	private:
+		std::vector<node> _nodes;
+		std::vector<aabb> _boxes;
+		std::vector<curve_id> _ids;
+
+		void _build(std::size_t index, std::uint32_t begin, std::uint32_t end, unsigned depth, void* context);
+		template <typename _overlaps>
+		void _query(const _overlaps& overlaps, std::vector<curve_id>& result) const;
+	public:
+		static constexpr std::uint32_t leaf_size = 4;
+
+		bvh() = default;
+		DLL_API bvh(const aabb* boxes, const curve_id* ids, std::size_t count);
+		// Every curve bounded over [t0, t1]; one turn covers circles and ellipses completely.
+		DLL_API bvh(const curve_collection& collection, double t0, double t1);
+
+		std::size_t size() const noexcept { return _ids.size(); }
+		const std::vector<node>& nodes() const noexcept { return _nodes; }
+		const aabb& box(std::size_t i) const noexcept { return _boxes[i]; }
+		curve_id id(std::size_t i) const noexcept { return _ids[i]; }
+
+		DLL_API void query(const aabb& box, std::vector<curve_id>& result) const;
+		DLL_API void query(const double* center, double radius, std::vector<curve_id>& result) const;
+		DLL_API void query(const frustum& region, std::vector<curve_id>& result) const;
+		// boxes within tolerance of the ray, by the slab test on boxes grown by tolerance
+		DLL_API void query(const ray& r, double tolerance, std::vector<curve_id>& result) const;
+		// The same boxes, the nearer child first at every node. visit returns the ray position
+		// (in units of direction) past which boxes are no longer entered.
+		DLL_API void query(const ray& r, double tolerance, const std::function<double(curve_id)>& visit) const;
+
+		// Gives every box its position as id, for data kept alongside the boxes in their order.
+		DLL_API void number_boxes() noexcept;
+	};
+
+	// Part [t0, t1] of curve id. Every point of it lies within reach of its chord from p to q:
+	// (t1 - t0)^2 / 8 times the largest |P''|, the major semi-axis of a and b.
+	struct arc
+	{
+		curve_id id;
+		double t0, t1;
+		double p[3], q[3], reach;
+	};
+
+	// Every curve of the collection over [t0, t1], circles and ellipses over one turn at most, cut
+	// into equal arcs no longer than step in t, in bucket order. Boxes are exact, grown by margin.
+	DLL_API void split_arcs(const curve_collection& collection, double t0, double t1, double step, double margin,
+		std::vector<arc>& arcs, std::vector<aabb>& boxes);
+
+	// A tree over the arcs of a collection, arcs() in the order of its boxes and its ids indexing
+	// them. A whole turn boxes a curve around everything it encircles; short arcs leave a region
+	// that crosses the curve somewhere only the arcs near the crossing.
+	class arc_tree final
+	{
+		std::vector<arc> _arcs;
+		bvh _tree;
+	public:
+		// pi / 4
+		static constexpr double default_step = 0.78539816339744830962;
+
+		arc_tree() = default;
+		DLL_API arc_tree(const curve_collection& collection, double t0, double t1, double step = default_step);
+
+		const std::vector<arc>& arcs() const noexcept { return _arcs; }
+		const bvh& tree() const noexcept { return _tree; }
+	};
+}
+
+#endif
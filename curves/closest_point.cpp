@@ -0,0 +1,361 @@
+#include "pch.h"
+#include "closest_point.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	using curves::numeric::pi;
+	using curves::numeric::two_pi;
+	using curves::numeric::dot;
+
+	const double _step = pi / 8.0;
+
+	void _normalize(double* u) noexcept
+	{
+		double length = std::sqrt(dot(u, u));
+		for (std::size_t i = 0; i < 3; ++i)
+			u[i] = length > 0.0 ? u[i] / length : 0.0;
+	}
+
+	// g(t) = |P - q|^2 / 2: returns g' = (P - q).P', sets g'' = P'.P' + (P - q).P'' and |P - q|^2
+	double _slope(const curves::baked_form& k, const double* q, double t, double& curvature, double& d2) noexcept
+	{
+		double c = std::cos(t), s = std::sin(t), p[3], d[3], dd[3];
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			dd[i] = -(k.a[i] * c + k.b[i] * s);
+			p[i] = -dd[i] + k.c[i] * t - q[i];
+			d[i] = -k.a[i] * s + k.b[i] * c + k.c[i];
+		}
+		curvature = dot(d, d) + dot(p, dd);
+		d2 = dot(p, p);
+		return dot(p, d);
+	}
+
+	// the minimum of g inside [lo, hi] as the root of g'
+	double _refine(const curves::baked_form& k, const double* q, double t, double lo, double hi, double& d2) noexcept
+	{
+		double step;
+		t = curves::numeric::newton([&k, q, &d2](double u, double& curvature) { return _slope(k, q, u, curvature, d2); },
+			t, lo, hi, step);
+		return t + step;
+	}
+
+	double _distance2(const curves::baked_form& k, const double* q, double t) noexcept
+	{
+		double curvature, d2;
+		_slope(k, q, t, curvature, d2);
+		return d2;
+	}
+
+	curves::closest_point _result(const curves::baked_form& k, const double* q, double t) noexcept
+	{
+		curves::closest_point result;
+		result.t = t;
+		curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t,
+			result.point[0], result.point[1], result.point[2]);
+		double d[3] = { result.point[0] - q[0], result.point[1] - q[1], result.point[2] - q[2] };
+		result.distance = std::sqrt(dot(d, d));
+		return result;
+	}
+
+	// One projector per distinct curve, prepared in parallel from form(j) of curve j.
+	template <typename _form>
+	std::vector<curves::projector> _projectors(std::size_t distinct, const _form& form)
+	{
+		std::vector<curves::projector> result(distinct, curves::projector(curves::baked_form{}));
+		const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(distinct);
+		#pragma omp parallel for schedule(static)
+		for (std::ptrdiff_t j = 0; j < n; ++j)
+			result[j] = curves::projector(form(static_cast<std::size_t>(j)));
+		return result;
+	}
+}
+
+curves::projector::projector(const baked_form& k) noexcept
+	: _k(k), _planar(k.c[0] == 0.0 && k.c[1] == 0.0 && k.c[2] == 0.0), _round(false),
+	_axis{}, _semi{}, _shift(0.0), _plane{}, _rate{}, _reach{}, _speed(0.0), _planes(0)
+{
+	const double* a = _k.a;
+	const double* b = _k.b;
+	const double* c = _k.c;
+	_speed = std::sqrt(dot(a, a)) + std::sqrt(dot(b, b)) + std::sqrt(dot(c, c));
+	if (_planar)
+	{
+		// a cos t + b sin t = e0 cos s + e1 sin s with s = t - shift and e0 orthogonal to e1, |e0| >= |e1|
+		double aa = dot(a, a), bb = dot(b, b), ab = dot(a, b);
+		_shift = 0.5 * std::atan2(2.0 * ab, aa - bb);
+		double cs = std::cos(_shift), sn = std::sin(_shift);
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			_axis[0][i] = a[i] * cs + b[i] * sn;
+			_axis[1][i] = b[i] * cs - a[i] * sn;
+		}
+		_semi[0] = std::sqrt(dot(_axis[0], _axis[0]));
+		_semi[1] = std::sqrt(dot(_axis[1], _axis[1]));
+		_normalize(_axis[0]);
+		_normalize(_axis[1]);
+		_round = _semi[0] - _semi[1] <= 1e-12 * _semi[0];
+		return;
+	}
+
+	// the normal of span(a, b) within c sees no oscillation; c itself always works
+	double e0[3], e1[3], n[3];
+	std::copy(a, a + 3, e0);
+	if (dot(e0, e0) == 0.0)
+		std::copy(b, b + 3, e0);
+	_normalize(e0);
+	double be = dot(b, e0);
+	for (std::size_t i = 0; i < 3; ++i)
+		e1[i] = b[i] - be * e0[i];
+	if (dot(e1, e1) <= 1e-24 * dot(b, b))
+		std::fill(e1, e1 + 3, 0.0);
+	_normalize(e1);
+	double ce0 = dot(c, e0), ce1 = dot(c, e1);
+	for (std::size_t i = 0; i < 3; ++i)
+		n[i] = c[i] - ce0 * e0[i] - ce1 * e1[i];
+	if (dot(n, n) > 1e-24 * dot(c, c))
+	{
+		_normalize(n);
+		std::copy(n, n + 3, _plane[_planes]);
+		_rate[_planes] = dot(c, n);
+		_reach[_planes++] = 0.0;
+	}
+	double* w = _plane[_planes];
+	std::copy(c, c + 3, w);
+	_normalize(w);
+	_rate[_planes] = dot(c, w);
+	_reach[_planes++] = std::hypot(dot(a, w), dot(b, w));
+}
+
+curves::projector::projector(const interface_curve& curve) noexcept
+	: projector(curve.get_baked_form()) {}
+
+curves::closest_point curves::projector::_planar_point(const double* q) const noexcept
+{
+	double u = dot(_axis[0], q), v = dot(_axis[1], q), s = 0.0;
+	if (_round)
+		s = u == 0.0 && v == 0.0 ? 0.0 : std::atan2(v, u);
+	else
+	{
+		// First quadrant of the principal frame, where the nearest point is (A^2 |u| / (A^2 + r),
+		// B^2 |v| / (B^2 + r)) for the root r of F(r) = (A |u| / (A^2 + r))^2 + (B |v| / (B^2 + r))^2 - 1.
+		// F is convex and decreasing for r > -B^2, so Newton from F(B |v| - B^2) >= 0 rises
+		// monotonically to the root.
+		double A = _semi[0], B = _semi[1], au = std::abs(u), av = std::abs(v), e = A * A - B * B;
+		if (av == 0.0 || B == 0.0)
+			s = A * au < e ? std::acos(A * au / e) : 0.0;
+		else
+		{
+			double r = B * av - B * B, x = 1.0, y = 0.0;
+			for (std::size_t i = 0; i < 64; ++i)
+			{
+				double da = A * A + r, db = B * B + r;
+				x = A * au / da;
+				y = B * av / db;
+				double f = x * x + y * y - 1.0;
+				if (!(f > 0.0))
+					break;
+				double step = 0.5 * f / (x * x / da + y * y / db);
+				r += step;
+				if (step <= 1e-15 * db)
+					break;
+			}
+			s = std::atan2(y, x);
+		}
+		s = std::atan2(v < 0.0 ? -std::sin(s) : std::sin(s), u < 0.0 ? -std::cos(s) : std::cos(s));
+	}
+	double t = std::fmod(s + _shift, two_pi);
+	return _result(_k, q, t < 0.0 ? t + two_pi : t);
+}
+
+void curves::projector::_scan(const double* q, double t0, double t1, double& best_t, double& best_d2) const noexcept
+{
+	if (!(t1 > t0))
+		return;
+	// samples t0 - h, t0, ..., t1, t1 + h: the outer two only frame the minima inside [t0, t1]
+	std::size_t n = std::max<std::size_t>(static_cast<std::size_t>(std::ceil((t1 - t0) / _step)), 1) + 3;
+	double h = (t1 - t0) / static_cast<double>(n - 3), drift = h * _speed;
+	double rc = std::cos(h), rs = std::sin(h), c = 0.0, s = 0.0;
+	double previous = HUGE_VAL, current = HUGE_VAL;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		double t = t0 + h * (static_cast<double>(i) - 1.0), next = 0.0;
+		if (i % 16 == 0)
+		{
+			c = std::cos(t);
+			s = std::sin(t);
+		}
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			double d = _k.a[j] * c + _k.b[j] * s + _k.c[j] * t - q[j];
+			next += d * d;
+		}
+		double rotated = c * rc - s * rs;
+		s = s * rc + c * rs;
+		c = rotated;
+		// a discrete minimum brackets a local minimum; skip it when the curve cannot come closer
+		// than the best so far within one step
+		if (i > 1 && current <= previous && current <= next)
+		{
+			double floor = std::sqrt(current) - drift;
+			if (floor <= 0.0 || floor * floor < best_d2)
+			{
+				// start from the vertex of the parabola through the three samples
+				double middle = t - h, bend = previous - 2.0 * current + next;
+				double lo = std::max(middle - h, t0), hi = std::min(middle + h, t1);
+				double start = bend > 0.0 ? middle + 0.5 * h * (previous - next) / bend : middle;
+				double d2, refined = _refine(_k, q, std::clamp(start, lo, hi), lo, hi, d2);
+				if (d2 < best_d2)
+				{
+					best_d2 = d2;
+					best_t = refined;
+				}
+			}
+		}
+		previous = current;
+		current = next;
+	}
+}
+
+curves::closest_point curves::projector::_helix_point(const double* q, double t0, double t1) const noexcept
+{
+	// the turn around the first plane's estimate, then the window its best distance allows
+	double first = std::clamp(dot(_plane[0], q) / _rate[0], t0, t1), best_t = first, best_d2 = _distance2(_k, q, first);
+	_scan(q, std::max(first - pi, t0), std::min(first + pi, t1), best_t, best_d2);
+
+	double distance = std::sqrt(best_d2), center = first, width = HUGE_VAL;
+	for (std::size_t i = 0; i < _planes; ++i)
+	{
+		double w = (distance + _reach[i]) / _rate[i];
+		if (w < width)
+		{
+			width = w;
+			center = dot(_plane[i], q) / _rate[i];
+		}
+	}
+	width = std::min(width, max_turns * two_pi);
+	double lo = std::max(center - width, t0), hi = std::min(center + width, t1);
+	_scan(q, lo, std::min(hi, first - pi), best_t, best_d2);
+	_scan(q, std::max(lo, first + pi), hi, best_t, best_d2);
+	_ends(q, t0, t1, best_t, best_d2);
+	return _result(_k, q, best_t);
+}
+
+// sampled minima leave out a range end the distance still falls towards
+void curves::projector::_ends(const double* q, double t0, double t1, double& best_t, double& best_d2) const noexcept
+{
+	for (double t : { t0, t1 })
+		if (std::isfinite(t))
+		{
+			double d2 = _distance2(_k, q, t);
+			if (d2 < best_d2)
+			{
+				best_d2 = d2;
+				best_t = t;
+			}
+		}
+}
+
+curves::closest_point curves::projector::operator()(double x, double y, double z) const noexcept
+{
+	const double q[3] = { x, y, z };
+	return _planar ? _planar_point(q) : _helix_point(q, -HUGE_VAL, HUGE_VAL);
+}
+
+curves::closest_point curves::projector::operator()(const curve_point& q) const noexcept
+{ return (*this)(q[0], q[1], q[2]); }
+
+curves::closest_point curves::projector::operator()(double x, double y, double z, double t0, double t1) const noexcept
+{
+	const double q[3] = { x, y, z };
+	if (!_planar)
+		return _helix_point(q, t0, t1);
+	if (t1 - t0 >= two_pi)
+	{
+		closest_point result = _planar_point(q);
+		double t = std::fmod(result.t - t0, two_pi);
+		result.t = t0 + (t < 0.0 ? t + two_pi : t);
+		return result;
+	}
+	double best_t = t0, best_d2 = HUGE_VAL;
+	_scan(q, t0, t1, best_t, best_d2);
+	_ends(q, t0, t1, best_t, best_d2);
+	return _result(_k, q, best_t);
+}
+
+curves::closest_point curves::projector::operator()(const curve_point& q, double t0, double t1) const noexcept
+{ return (*this)(q[0], q[1], q[2], t0, t1); }
+
+curves::closest_point curves::closest(const interface_curve& curve, const curve_point& q) noexcept
+{ return projector(curve)(q); }
+
+void curves::closest_points(const curve_builder::curve_ptr* curves, const curve_point* points, std::size_t count,
+	double* t, double* distance)
+{
+	// pairs sharing a curve share its projector
+	std::unordered_map<const interface_curve*, std::size_t> first;
+	std::vector<const interface_curve*> distinct;
+	std::vector<std::size_t> which(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto entry = first.emplace(curves[i].get(), distinct.size());
+		if (entry.second)
+			distinct.push_back(curves[i].get());
+		which[i] = entry.first->second;
+	}
+	const std::vector<projector> projectors = _projectors(distinct.size(),
+		[&distinct](std::size_t j) -> const baked_form& { return distinct[j]->get_baked_form(); });
+
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(count);
+	#pragma omp parallel for schedule(dynamic, 1024)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		closest_point result = projectors[which[i]](points[i]);
+		t[i] = result.t;
+		if (distance)
+			distance[i] = result.distance;
+	}
+}
+
+void curves::closest_points(const curve_collection& collection, const curve_id* ids,
+	const double* x, const double* y, const double* z, std::size_t count, double* t, double* distance)
+{
+	// checked up front: an exception cannot leave the parallel region
+	std::vector<std::size_t> first(collection.next_id(), curve_collection::npos), which(count);
+	std::vector<curve_id> distinct;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (!collection.contains(ids[i]))
+			throw curve_builder::build_exception("Unknown curve id");
+		std::size_t& j = first[ids[i]];
+		if (j == curve_collection::npos)
+		{
+			j = distinct.size();
+			distinct.push_back(ids[i]);
+		}
+		which[i] = j;
+	}
+	const std::vector<projector> projectors = _projectors(distinct.size(),
+		[&collection, &distinct](std::size_t j) -> const baked_form&
+	{
+		curve_collection::slot s = collection.find(distinct[j]);
+		return s.type == CIRCLE ? collection.circles().baked[s.index]
+			: s.type == ELLIPSE ? collection.ellipses().baked[s.index] : collection.helices().baked[s.index];
+	});
+
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(count);
+	#pragma omp parallel for schedule(dynamic, 1024)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		closest_point result = projectors[which[i]](x[i], y[i], z[i]);
+		t[i] = result.t;
+		if (distance)
+			distance[i] = result.distance;
+	}
+}
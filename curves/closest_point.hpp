@@ -0,0 +1,67 @@
+#ifndef _CAD_CLOSEST_POINT
+#define _CAD_CLOSEST_POINT
+
+#include "collection.hpp"
+
+namespace curves
+{
+	struct closest_point
+	{
+		double t;
+		curve_point point;
+		double distance;
+	};
+
+	// Closest point of one curve, with the curve-local frame prepared once for repeated queries.
+	// Circles and ellipses, under any operator, are ellipses a cos t + b sin t in the plane of
+	// a and b. The frame holds their principal axes and the parameter shift that maps t onto
+	// them: round shapes are solved by atan2, the others by Newton on the quadrant of the query,
+	// where the root is unique and bracketed. Helices have no closed form. A point at parameter t
+	// stays within a fixed distance of the plane w.p = rate * t, so the global minimum lies in a
+	// window around (w.q) / rate whose width follows from the best distance found so far; the
+	// window is scanned in steps of pi / 8 and every local minimum of the samples is refined by
+	// safeguarded Newton.
+	class projector final
+	{
+		baked_form _k;
+		bool _planar, _round;
+		// planar: unit principal axes, semi-axes A >= B and t = s + _shift
+		double _axis[2][3], _semi[2], _shift;
+		// helix: planes w.p = rate * t + r(t) with |r(t)| <= reach
+		double _plane[2][3], _rate[2], _reach[2];
+		// |a| + |b| + |c| >= |P'|
+		double _speed;
+		std::size_t _planes;
+
+		closest_point _planar_point(const double* q) const noexcept;
+		closest_point _helix_point(const double* q, double t0, double t1) const noexcept;
+		void _scan(const double* q, double t0, double t1, double& best_t, double& best_d2) const noexcept;
+		void _ends(const double* q, double t0, double t1, double& best_t, double& best_d2) const noexcept;
+	public:
+		// windows wider than this many turns are clamped, which only matters for nearly closed helices
+		static constexpr double max_turns = 64.0;
+
+		DLL_API explicit projector(const baked_form& k) noexcept;
+		DLL_API explicit projector(const interface_curve& curve) noexcept;
+
+		// t in [0, 2 pi) for circles and ellipses, any real t for helices
+		DLL_API closest_point operator()(const curve_point& q) const noexcept;
+		DLL_API closest_point operator()(double x, double y, double z) const noexcept;
+		// Only t in [t0, t1]: the helix window is cut to it, and circles and ellipses are
+		// scanned unless it covers a whole turn, in which case t is mapped into [t0, t0 + 2 pi).
+		DLL_API closest_point operator()(const curve_point& q, double t0, double t1) const noexcept;
+		DLL_API closest_point operator()(double x, double y, double z, double t0, double t1) const noexcept;
+	};
+
+	DLL_API closest_point closest(const interface_curve& curve, const curve_point& q) noexcept;
+
+	// Pair i is (curves[i], points[i]) or (collection curve ids[i], (x[i], y[i], z[i])); pairs run
+	// in parallel and distance may be null. Each distinct curve gets one projector, shared by all
+	// its pairs. An erased or unknown id throws build_exception before any pair is evaluated.
+	DLL_API void closest_points(const curve_builder::curve_ptr* curves, const curve_point* points, std::size_t count,
+		double* t, double* distance = nullptr);
+	DLL_API void closest_points(const curve_collection& collection, const curve_id* ids,
+		const double* x, const double* y, const double* z, std::size_t count, double* t, double* distance = nullptr);
+}
+
+#endif
@@ -0,0 +1,549 @@
+#include "pch.h"
+#include "collection.hpp"
+#include "simd.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using _circles = curves::curve_collection::circle_bucket;
+	using _ellipses = curves::curve_collection::ellipse_bucket;
+	using _helices = curves::curve_collection::helix_bucket;
+
+	template <bool _derivative, typename _bucket>
+	void _evaluate(const _bucket& b, const double* t, double* x, double* y, double* z) noexcept
+	{
+		for (std::size_t i = 0; i < b.id.size(); ++i)
+		{
+			double c = std::cos(t[i]), s = std::sin(t[i]);
+			if constexpr (_derivative)
+				curves::combine(b.op_type[i], b.baked[i], -s, c, 1.0, x[i], y[i], z[i]);
+			else
+				curves::combine(b.op_type[i], b.baked[i], c, s, t[i], x[i], y[i], z[i]);
+		}
+	}
+
+	template <bool _derivative>
+	void _evaluate(const curves::curve_collection& collection, curves::curve_t type,
+		const double* t, double* x, double* y, double* z) noexcept
+	{
+		switch (type)
+		{
+		case curves::CIRCLE:
+			_evaluate<_derivative>(collection.circles(), t, x, y, z);
+			break;
+		case curves::ELLIPSE:
+			_evaluate<_derivative>(collection.ellipses(), t, x, y, z);
+			break;
+		case curves::HELIX:
+			_evaluate<_derivative>(collection.helices(), t, x, y, z);
+			break;
+		}
+	}
+
+	template <bool _derivative>
+	void _evaluate(const curves::curve_collection& collection,
+		const double* t, double* x, double* y, double* z) noexcept
+	{
+		std::size_t offset = 0;
+		for (curves::curve_t type : { curves::CIRCLE, curves::ELLIPSE, curves::HELIX })
+		{
+			_evaluate<_derivative>(collection, type, t + offset, x + offset, y + offset, z + offset);
+			offset += collection.size(type);
+		}
+	}
+
+	template <bool _derivative, typename _bucket>
+	void _evaluate_at(const _bucket& b, double t, double c, double s,
+		double* x, double* y, double* z) noexcept
+	{
+		double wa = _derivative ? -s : c, wb = _derivative ? c : s, wc = _derivative ? 1.0 : t;
+		for (std::size_t i = 0; i < b.id.size(); ++i)
+			curves::combine(b.op_type[i], b.baked[i], wa, wb, wc, x[i], y[i], z[i]);
+	}
+
+	template <bool _derivative>
+	void _evaluate_at(const curves::curve_collection& collection, curves::curve_t type,
+		double t, double c, double s, double* x, double* y, double* z) noexcept
+	{
+		switch (type)
+		{
+		case curves::CIRCLE:
+			_evaluate_at<_derivative>(collection.circles(), t, c, s, x, y, z);
+			break;
+		case curves::ELLIPSE:
+			_evaluate_at<_derivative>(collection.ellipses(), t, c, s, x, y, z);
+			break;
+		case curves::HELIX:
+			_evaluate_at<_derivative>(collection.helices(), t, c, s, x, y, z);
+			break;
+		}
+	}
+
+	template <bool _derivative>
+	void _evaluate_at(const curves::curve_collection& collection,
+		double t, double c, double s, double* x, double* y, double* z) noexcept
+	{
+		std::size_t offset = 0;
+		for (curves::curve_t type : { curves::CIRCLE, curves::ELLIPSE, curves::HELIX })
+		{
+			_evaluate_at<_derivative>(collection, type, t, c, s, x + offset, y + offset, z + offset);
+			offset += collection.size(type);
+		}
+	}
+
+	bool _less(const curves::radius_index::entry& a, const curves::radius_index::entry& b) noexcept
+	{ return a.R < b.R || (a.R == b.R && a.id < b.id); }
+
+	template <typename _type>
+	void _swap_pop(std::vector<_type>& v, std::size_t index)
+	{
+		v[index] = v.back();
+		v.pop_back();
+	}
+
+	void _check(double value)
+	{
+		if (!(value >= 0.0))
+			throw curves::curve_builder::build_exception("Curve is not physically correct");
+	}
+}
+
+curves::sincos_table::sincos_table(const double* t, std::size_t count)
+	: t(t, t + count), s(count), c(count)
+{ simd::sincos(t, count, s.data(), c.data()); }
+
+curves::sincos_table::sincos_table(double t0, double dt, std::size_t count)
+	: t(count), s(count), c(count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+		t[i] = t0 + dt * static_cast<double>(i);
+	simd::sincos(t.data(), count, s.data(), c.data());
+}
+
+void curves::radius_index::insert(double R, curve_id id) { _inserted.push_back({ R, id }); }
+
+void curves::radius_index::erase(double R, curve_id id) { _erased.push_back({ R, id }); }
+
+void curves::radius_index::merge()
+{
+	if (!pending())
+		return;
+	std::sort(_inserted.begin(), _inserted.end(), _less);
+	std::sort(_erased.begin(), _erased.end(), _less);
+
+	std::vector<entry> inserted, erased;
+	std::set_difference(_inserted.begin(), _inserted.end(), _erased.begin(), _erased.end(),
+		std::back_inserter(inserted), _less);
+	std::set_difference(_erased.begin(), _erased.end(), _inserted.begin(), _inserted.end(),
+		std::back_inserter(erased), _less);
+
+	std::vector<entry> kept;
+	kept.reserve(_entries.size() - std::min(_entries.size(), erased.size()));
+	std::set_difference(_entries.begin(), _entries.end(), erased.begin(), erased.end(),
+		std::back_inserter(kept), _less);
+
+	_entries.clear();
+	_entries.reserve(kept.size() + inserted.size());
+	std::merge(kept.begin(), kept.end(), inserted.begin(), inserted.end(),
+		std::back_inserter(_entries), _less);
+
+	_prefix.resize(_entries.size() + 1);
+	_prefix[0] = 0.0;
+	for (std::size_t i = 0; i < _entries.size(); ++i)
+		_prefix[i + 1] = _prefix[i] + _entries[i].R;
+
+	_inserted.clear();
+	_erased.clear();
+}
+
+void curves::radius_index::clear() noexcept
+{
+	_entries.clear();
+	_prefix.clear();
+	_inserted.clear();
+	_erased.clear();
+}
+
+std::pair<const curves::radius_index::entry*, const curves::radius_index::entry*>
+	curves::radius_index::range(double a, double b) const noexcept
+{
+	const entry* first = std::lower_bound(begin(), end(), a,
+		[](const entry& e, double value) { return e.R < value; });
+	const entry* last = std::upper_bound(first, end(), b,
+		[](double value, const entry& e) { return value < e.R; });
+	return { first, last };
+}
+
+std::pair<const curves::radius_index::entry*, const curves::radius_index::entry*>
+	curves::radius_index::top(std::size_t k) const noexcept
+{ return { end() - std::min(k, size()), end() }; }
+
+double curves::radius_index::prefix_sum(std::size_t n) const noexcept
+{ return _prefix.empty() ? 0.0 : _prefix[std::min(n, size())]; }
+
+double curves::radius_index::sum(double a, double b) const noexcept
+{
+	auto bounds = range(a, b);
+	return prefix_sum(bounds.second - begin()) - prefix_sum(bounds.first - begin());
+}
+
+curves::curve_id curves::curve_collection::add_circle(double R, const mv::mat3& linear_operator)
+{
+	_check(R);
+	curve_id id = _slots.size();
+	_slots.push_back({ CIRCLE, _circles.id.size() });
+	_circles.R.push_back(R);
+	_circles.lin_op.push_back(linear_operator);
+	_circles.op_type.push_back(classify(linear_operator));
+	_circles.baked.push_back(bake(linear_operator, R, R, 0.0));
+	_circles.id.push_back(id);
+	_radii.insert(R, id);
+	return id;
+}
+
+curves::curve_id curves::curve_collection::add_ellipse(double Rx, double Ry, const mv::mat3& linear_operator)
+{
+	_check(Rx);
+	_check(Ry);
+	curve_id id = _slots.size();
+	_slots.push_back({ ELLIPSE, _ellipses.id.size() });
+	_ellipses.Rx.push_back(Rx);
+	_ellipses.Ry.push_back(Ry);
+	_ellipses.lin_op.push_back(linear_operator);
+	_ellipses.op_type.push_back(classify(linear_operator));
+	_ellipses.baked.push_back(bake(linear_operator, Rx, Ry, 0.0));
+	_ellipses.id.push_back(id);
+	return id;
+}
+
+curves::curve_id curves::curve_collection::add_helix(double R, double h, const mv::mat3& linear_operator)
+{
+	_check(R);
+	_check(h);
+	curve_id id = _slots.size();
+	_slots.push_back({ HELIX, _helices.id.size() });
+	_helices.R.push_back(R);
+	_helices.h.push_back(h);
+	_helices.lin_op.push_back(linear_operator);
+	_helices.op_type.push_back(classify(linear_operator));
+	_helices.baked.push_back(bake(linear_operator, R, R, h));
+	_helices.id.push_back(id);
+	return id;
+}
+
+curves::curve_id curves::curve_collection::add(const interface_curve& curve)
+{
+	switch (curve.get_type())
+	{
+	case ELLIPSE:
+	{
+		const ellipse& e = static_cast<const ellipse&>(curve);
+		return add_ellipse(e.get_radius_x(), e.get_radius_y(), e.get_linear_operator());
+	}
+	case HELIX:
+	{
+		const helix& h = static_cast<const helix&>(curve);
+		return add_helix(h.get_radius(), h.get_step(), h.get_linear_operator());
+	}
+	default:
+		return add_circle(static_cast<const circle&>(curve).get_radius(), curve.get_linear_operator());
+	}
+}
+
+void curves::curve_collection::add_random(std::size_t count, std::uint64_t seed, const random_options& options)
+{
+	validate(options);
+	const philox generator(seed);
+	using counts = std::array<std::size_t, 3>;
+	const std::size_t blocks = (count + reduce::block - 1) / reduce::block;
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(blocks);
+
+	// first pass: curve types only, counted per block and scanned into the first row of every block
+	std::vector<counts> rows(blocks + 1, counts{ 0, 0, 0 });
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t b = 0; b < n; ++b)
+	{
+		std::size_t first = static_cast<std::size_t>(b) * reduce::block;
+		std::size_t last = std::min(first + reduce::block, count);
+		for (std::size_t i = first; i < last; ++i)
+			++rows[b + 1][draw_type(generator, i, options)];
+	}
+	rows[0] = count_by_type(*this);
+	for (std::size_t b = 1; b <= blocks; ++b)
+		for (std::size_t type = 0; type < 3; ++type)
+			rows[b][type] += rows[b - 1][type];
+
+	const std::size_t first_circle = _circles.id.size();
+	const curve_id first_id = _slots.size();
+	_slots.resize(first_id + count);
+	_circles.R.resize(rows[blocks][CIRCLE]);
+	_circles.lin_op.resize(rows[blocks][CIRCLE]);
+	_circles.op_type.resize(rows[blocks][CIRCLE]);
+	_circles.baked.resize(rows[blocks][CIRCLE]);
+	_circles.id.resize(rows[blocks][CIRCLE]);
+	_ellipses.Rx.resize(rows[blocks][ELLIPSE]);
+	_ellipses.Ry.resize(rows[blocks][ELLIPSE]);
+	_ellipses.lin_op.resize(rows[blocks][ELLIPSE]);
+	_ellipses.op_type.resize(rows[blocks][ELLIPSE]);
+	_ellipses.baked.resize(rows[blocks][ELLIPSE]);
+	_ellipses.id.resize(rows[blocks][ELLIPSE]);
+	_helices.R.resize(rows[blocks][HELIX]);
+	_helices.h.resize(rows[blocks][HELIX]);
+	_helices.lin_op.resize(rows[blocks][HELIX]);
+	_helices.op_type.resize(rows[blocks][HELIX]);
+	_helices.baked.resize(rows[blocks][HELIX]);
+	_helices.id.resize(rows[blocks][HELIX]);
+
+	// second pass: every block fills its own rows of each bucket
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t b = 0; b < n; ++b)
+	{
+		counts row = rows[b];
+		std::size_t first = static_cast<std::size_t>(b) * reduce::block;
+		std::size_t last = std::min(first + reduce::block, count);
+		for (std::size_t i = first; i < last; ++i)
+		{
+			random_curve curve = draw_curve(generator, i, options);
+			curve_id id = first_id + i;
+			std::size_t r = row[curve.type]++;
+			_slots[id] = { curve.type, r };
+			operator_t op_type = classify(curve.lin_op);
+			switch (curve.type)
+			{
+			case CIRCLE:
+				_circles.R[r] = curve.p0;
+				_circles.lin_op[r] = curve.lin_op;
+				_circles.op_type[r] = op_type;
+				_circles.baked[r] = bake(curve.lin_op, curve.p0, curve.p0, 0.0);
+				_circles.id[r] = id;
+				break;
+			case ELLIPSE:
+				_ellipses.Rx[r] = curve.p0;
+				_ellipses.Ry[r] = curve.p1;
+				_ellipses.lin_op[r] = curve.lin_op;
+				_ellipses.op_type[r] = op_type;
+				_ellipses.baked[r] = bake(curve.lin_op, curve.p0, curve.p1, 0.0);
+				_ellipses.id[r] = id;
+				break;
+			case HELIX:
+				_helices.R[r] = curve.p0;
+				_helices.h[r] = curve.p1;
+				_helices.lin_op[r] = curve.lin_op;
+				_helices.op_type[r] = op_type;
+				_helices.baked[r] = bake(curve.lin_op, curve.p0, curve.p0, curve.p1);
+				_helices.id[r] = id;
+				break;
+			}
+		}
+	}
+
+	for (std::size_t r = first_circle; r < _circles.id.size(); ++r)
+		_radii.insert(_circles.R[r], _circles.id[r]);
+}
+
+void curves::curve_collection::erase(curve_id id)
+{
+	if (!contains(id))
+		return;
+	slot s = _slots[id];
+	curve_id moved = npos;
+	switch (s.type)
+	{
+	case CIRCLE:
+		_radii.erase(_circles.R[s.index], id);
+		moved = _circles.id.back();
+		_swap_pop(_circles.R, s.index);
+		_swap_pop(_circles.lin_op, s.index);
+		_swap_pop(_circles.op_type, s.index);
+		_swap_pop(_circles.baked, s.index);
+		_swap_pop(_circles.id, s.index);
+		break;
+	case ELLIPSE:
+		moved = _ellipses.id.back();
+		_swap_pop(_ellipses.Rx, s.index);
+		_swap_pop(_ellipses.Ry, s.index);
+		_swap_pop(_ellipses.lin_op, s.index);
+		_swap_pop(_ellipses.op_type, s.index);
+		_swap_pop(_ellipses.baked, s.index);
+		_swap_pop(_ellipses.id, s.index);
+		break;
+	case HELIX:
+		moved = _helices.id.back();
+		_swap_pop(_helices.R, s.index);
+		_swap_pop(_helices.h, s.index);
+		_swap_pop(_helices.lin_op, s.index);
+		_swap_pop(_helices.op_type, s.index);
+		_swap_pop(_helices.baked, s.index);
+		_swap_pop(_helices.id, s.index);
+		break;
+	}
+	_slots[moved].index = s.index;
+	_slots[id].index = npos;
+}
+
+void curves::curve_collection::erase(const curve_id* ids, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+		erase(ids[i]);
+}
+
+void curves::curve_collection::reserve(curve_t type, std::size_t count)
+{
+	_slots.reserve(_slots.size() + count);
+	switch (type)
+	{
+	case CIRCLE:
+		_circles.R.reserve(count);
+		_circles.lin_op.reserve(count);
+		_circles.op_type.reserve(count);
+		_circles.baked.reserve(count);
+		_circles.id.reserve(count);
+		break;
+	case ELLIPSE:
+		_ellipses.Rx.reserve(count);
+		_ellipses.Ry.reserve(count);
+		_ellipses.lin_op.reserve(count);
+		_ellipses.op_type.reserve(count);
+		_ellipses.baked.reserve(count);
+		_ellipses.id.reserve(count);
+		break;
+	case HELIX:
+		_helices.R.reserve(count);
+		_helices.h.reserve(count);
+		_helices.lin_op.reserve(count);
+		_helices.op_type.reserve(count);
+		_helices.baked.reserve(count);
+		_helices.id.reserve(count);
+		break;
+	}
+}
+
+void curves::curve_collection::clear() noexcept
+{
+	_circles = circle_bucket();
+	_ellipses = ellipse_bucket();
+	_helices = helix_bucket();
+	_slots.clear();
+	_radii.clear();
+}
+
+std::size_t curves::curve_collection::size() const noexcept
+{ return _circles.id.size() + _ellipses.id.size() + _helices.id.size(); }
+
+std::size_t curves::curve_collection::size(curve_t type) const noexcept
+{
+	switch (type)
+	{
+	case CIRCLE:
+		return _circles.id.size();
+	case ELLIPSE:
+		return _ellipses.id.size();
+	case HELIX:
+		return _helices.id.size();
+	}
+	return 0;
+}
+
+bool curves::curve_collection::contains(curve_id id) const noexcept
+{ return id < _slots.size() && _slots[id].index != npos; }
+
+curves::curve_id curves::curve_collection::next_id() const noexcept { return _slots.size(); }
+
+curves::curve_collection::slot curves::curve_collection::find(curve_id id) const noexcept
+{ return id < _slots.size() ? _slots[id] : slot{ CIRCLE, npos }; }
+
+const curves::radius_index& curves::curve_collection::circle_radii() const
+{
+	_radii.merge();
+	return _radii;
+}
+
+curves::curve_builder::curve_ptr curves::curve_collection::make_curve(curve_id id) const
+{
+	slot s = find(id);
+	if (s.index == npos)
+		throw curve_builder::build_exception("Unknown curve id");
+	switch (s.type)
+	{
+	case ELLIPSE:
+		return curve_builder::make_curve<ELLIPSE>(
+			_ellipses.Rx[s.index], _ellipses.Ry[s.index], _ellipses.lin_op[s.index]);
+	case HELIX:
+		return curve_builder::make_curve<HELIX>(
+			_helices.R[s.index], _helices.h[s.index], _helices.lin_op[s.index]);
+	default:
+		return curve_builder::make_curve<CIRCLE>(_circles.R[s.index], _circles.lin_op[s.index]);
+	}
+}
+
+void curves::curve_collection::get_values(curve_t type, const double* t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate<false>(*this, type, t, x, y, z); }
+
+void curves::curve_collection::get_d_dt_values(curve_t type, const double* t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate<true>(*this, type, t, x, y, z); }
+
+void curves::curve_collection::get_values(const double* t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate<false>(*this, t, x, y, z); }
+
+void curves::curve_collection::get_d_dt_values(const double* t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate<true>(*this, t, x, y, z); }
+
+void curves::curve_collection::get_values_at(curve_t type, double t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<false>(*this, type, t, std::cos(t), std::sin(t), x, y, z); }
+
+void curves::curve_collection::get_d_dt_values_at(curve_t type, double t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<true>(*this, type, t, std::cos(t), std::sin(t), x, y, z); }
+
+void curves::curve_collection::get_values_at(double t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<false>(*this, t, std::cos(t), std::sin(t), x, y, z); }
+
+void curves::curve_collection::get_d_dt_values_at(double t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<true>(*this, t, std::cos(t), std::sin(t), x, y, z); }
+
+void curves::curve_collection::get_values_at(const sincos_table& table, std::size_t k,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<false>(*this, table.t[k], table.c[k], table.s[k], x, y, z); }
+
+void curves::curve_collection::get_d_dt_values_at(const sincos_table& table, std::size_t k,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<true>(*this, table.t[k], table.c[k], table.s[k], x, y, z); }
+
+curves::reduce::statistics curves::aggregate(const curve_collection& collection,
+	curve_t type, parameter_t parameter, reduce::mode_t mode)
+{
+	const std::vector<double>* values = nullptr;
+	if (type == CIRCLE && parameter == RADIUS)
+		values = &collection.circles().R;
+	else if (type == ELLIPSE && parameter == RADIUS_X)
+		values = &collection.ellipses().Rx;
+	else if (type == ELLIPSE && parameter == RADIUS_Y)
+		values = &collection.ellipses().Ry;
+	else if (type == HELIX && parameter == RADIUS)
+		values = &collection.helices().R;
+	else if (type == HELIX && parameter == STEP)
+		values = &collection.helices().h;
+	if (values == nullptr)
+		return reduce::statistics();
+	return reduce::run(values->data(), values->size(), mode);
+}
+
+std::array<std::size_t, 3> curves::count_by_type(const curve_collection& collection) noexcept
+{ return { collection.size(CIRCLE), collection.size(ELLIPSE), collection.size(HELIX) }; }
+
+std::array<std::size_t, 3> curves::count_by_type(const curve_builder::curve_ptr* curves, std::size_t count)
+{
+	using counts = std::array<std::size_t, 3>;
+	return reduce::run(count, counts{ 0, 0, 0 },
+		[curves](counts& partial, std::size_t i) { ++partial[curves[i]->get_type()]; },
+		[](const counts& a, const counts& b) { return counts{ a[0] + b[0], a[1] + b[1], a[2] + b[2] }; });
+}
@@ -0,0 +1,178 @@
+#ifndef _CAD_COLLECTION
+#define _CAD_COLLECTION
+
+#include <vector>
+#include <array>
+
+#include "curves.hpp"
+#include "random.hpp"
+#include "reduce.hpp"
+
+namespace curves
+{
+	using curve_id = std::size_t;
+
+	class mapped_collection;
+
+	// Sines and cosines of a fixed parameter grid, computed once and shared by every curve.
+	struct sincos_table
+	{
+		std::vector<double> t, s, c;
+
+		DLL_API sincos_table(const double* t, std::size_t count);
+		DLL_API sincos_table(double t0, double dt, std::size_t count);
+
+		std::size_t size() const noexcept { return t.size(); }
+	};
+
+	// Circle radii in ascending order with their prefix sums. Edits are queued and applied
+	// together by merge() in O(n + k log k); queries assume no pending edits and run in O(log n).
+	class radius_index final
+	{
+	public:
+		struct entry
+		{
+			double R;
+			curve_id id;
+		};
+	private:
+		std::vector<entry> _entries;
+		std::vector<double> _prefix;
+		std::vector<entry> _inserted, _erased;
+	public:
+		DLL_API void insert(double R, curve_id id);
+		DLL_API void erase(double R, curve_id id);
+		DLL_API void merge();
+		DLL_API void clear() noexcept;
+		bool pending() const noexcept { return !_inserted.empty() || !_erased.empty(); }
+
+		std::size_t size() const noexcept { return _entries.size(); }
+		const entry* begin() const noexcept { return _entries.data(); }
+		const entry* end() const noexcept { return _entries.data() + _entries.size(); }
+
+		// entries with R in [a, b]
+		DLL_API std::pair<const entry*, const entry*> range(double a, double b) const noexcept;
+		// the k largest radii, ascending
+		DLL_API std::pair<const entry*, const entry*> top(std::size_t k) const noexcept;
+		// sum of the n smallest radii
+		DLL_API double prefix_sum(std::size_t n) const noexcept;
+		// sum of the radii in [a, b]
+		DLL_API double sum(double a, double b) const noexcept;
+	};
+
+	// Curves are kept in one contiguous structure-of-arrays bucket per curve_t.
+	// Batch traversals walk the buckets in the order circles, ellipses, helices;
+	// id[i] maps a bucket row back to the identifier returned on insertion.
+	// Identifiers stay valid across erasure of other curves and are not reused; clear() starts
+	// them again at 0.
+	class curve_collection final
+	{
+	public:
+		struct circle_bucket
+		{
+			std::vector<double> R;
+			std::vector<mv::mat3> lin_op;
+			std::vector<operator_t> op_type;
+			std::vector<baked_form> baked;
+			std::vector<curve_id> id;
+		};
+
+		struct ellipse_bucket
+		{
+			std::vector<double> Rx, Ry;
+			std::vector<mv::mat3> lin_op;
+			std::vector<operator_t> op_type;
+			std::vector<baked_form> baked;
+			std::vector<curve_id> id;
+		};
+
+		struct helix_bucket
+		{
+			std::vector<double> R, h;
+			std::vector<mv::mat3> lin_op;
+			std::vector<operator_t> op_type;
+			std::vector<baked_form> baked;
+			std::vector<curve_id> id;
+		};
+
+		struct slot
+		{
+			curve_t type;
+			std::size_t index;
+		};
+
+		static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+	private:
+		circle_bucket _circles;
+		ellipse_bucket _ellipses;
+		helix_bucket _helices;
+		std::vector<slot> _slots;
+		mutable radius_index _radii;
+
+		friend class mapped_collection;
+	public:
+		DLL_API curve_id add_circle(double R, const mv::mat3& linear_operator = mv::mat3());
+		DLL_API curve_id add_ellipse(double Rx, double Ry, const mv::mat3& linear_operator = mv::mat3());
+		DLL_API curve_id add_helix(double R, double h, const mv::mat3& linear_operator = mv::mat3());
+		DLL_API curve_id add(const interface_curve& curve);
+
+		// Appends count curves drawn from seed in parallel. Curve i of the call gets id
+		// next_id() + i and equals make_random_curve(seed, i, options) on any number of threads.
+		DLL_API void add_random(std::size_t count, std::uint64_t seed, const random_options& options = random_options());
+
+		// Erased rows are filled from the end of their bucket, so bucket order is not preserved.
+		DLL_API void erase(curve_id id);
+		DLL_API void erase(const curve_id* ids, std::size_t count);
+
+		DLL_API void reserve(curve_t type, std::size_t count);
+		DLL_API void clear() noexcept;
+
+		DLL_API std::size_t size() const noexcept;
+		DLL_API std::size_t size(curve_t type) const noexcept;
+		DLL_API bool contains(curve_id id) const noexcept;
+		// identifier the next insertion gets; erased ids stay below it
+		DLL_API curve_id next_id() const noexcept;
+		// index is npos for an erased or unknown id, and make_curve throws build_exception.
+		DLL_API slot find(curve_id id) const noexcept;
+		DLL_API curve_builder::curve_ptr make_curve(curve_id id) const;
+
+		const circle_bucket& circles() const noexcept { return _circles; }
+		const ellipse_bucket& ellipses() const noexcept { return _ellipses; }
+		const helix_bucket& helices() const noexcept { return _helices; }
+
+		// Applies edits queued since the last call; do not call concurrently after edits.
+		DLL_API const radius_index& circle_radii() const;
+
+		// t, x, y and z hold size(type) entries: row i of the bucket is evaluated at t[i].
+		DLL_API void get_values(curve_t type, const double* t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values(curve_t type, const double* t, double* x, double* y, double* z) const noexcept;
+
+		// Whole-collection forms: t, x, y and z hold size() entries in bucket order.
+		DLL_API void get_values(const double* t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values(const double* t, double* x, double* y, double* z) const noexcept;
+
+		// Every curve at the same parameter: cos and sin are computed once for the whole call.
+		DLL_API void get_values_at(curve_t type, double t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values_at(curve_t type, double t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_values_at(double t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values_at(double t, double* x, double* y, double* z) const noexcept;
+
+		// Every curve at node k of a precomputed grid.
+		DLL_API void get_values_at(const sincos_table& table, std::size_t k,
+			double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values_at(const sincos_table& table, std::size_t k,
+			double* x, double* y, double* z) const noexcept;
+	};
+
+	enum parameter_t { RADIUS = 0, RADIUS_X = 1, RADIUS_Y = 2, STEP = 3 };
+
+	// Parallel statistics of one parameter over one bucket: RADIUS for circles and helices,
+	// RADIUS_X and RADIUS_Y for ellipses, STEP for helices. Other combinations are empty.
+	DLL_API reduce::statistics aggregate(const curve_collection& collection, curve_t type, parameter_t parameter,
+		reduce::mode_t mode = reduce::FAST);
+
+	DLL_API std::array<std::size_t, 3> count_by_type(const curve_collection& collection) noexcept;
+	DLL_API std::array<std::size_t, 3> count_by_type(const curve_builder::curve_ptr* curves, std::size_t count);
+}
+
+#endif
@@ -1,39 +1,243 @@
 #include "pch.h"
 #include "curves.hpp"
+#include "exceptions.hpp"
+#include "simd.hpp"
 
-curves::interface_curve::interface_curve() {}
+#include <algorithm>
 
-curves::interface_curve::interface_curve(const mv::mat3& mat) noexcept 
-	: _lin_op(mat) {}
+namespace
+{
+	template <curves::operator_t _type, bool _value, bool _derivative>
+	void _batch(const curves::baked_form& k, const double* t, std::size_t count,
+		curves::curve_point* values, curves::curve_point* derivatives) noexcept
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			double c = std::cos(t[i]), s = std::sin(t[i]);
+			if constexpr (_value)
+				curves::combine<_type>(k, c, s, t[i], values[i][0], values[i][1], values[i][2]);
+			if constexpr (_derivative)
+				curves::combine<_type>(k, -s, c, 1.0, derivatives[i][0], derivatives[i][1], derivatives[i][2]);
+		}
+	}
+
+	template <bool _value, bool _derivative>
+	void _batch(curves::operator_t type, const curves::baked_form& k, const double* t, std::size_t count,
+		curves::curve_point* values, curves::curve_point* derivatives) noexcept
+	{
+		if (type == curves::IDENTITY || type == curves::DIAGONAL)
+			_batch<curves::DIAGONAL, _value, _derivative>(k, t, count, values, derivatives);
+		else
+			_batch<curves::GENERAL, _value, _derivative>(k, t, count, values, derivatives);
+	}
+
+	constexpr std::size_t _anchor = 64;
+	constexpr std::size_t _block = 256;
+
+	template <curves::operator_t _type>
+	void _derivatives(const curves::baked_form& k, const double* t, std::size_t count, curves::curve_point* values,
+		curves::curve_point* d1, curves::curve_point* d2, curves::curve_point* d3) noexcept
+	{
+		double s[_block], c[_block], h[3];
+		curves::combine<_type>(k, 0.0, 0.0, 1.0, h[0], h[1], h[2]);
+		for (std::size_t first = 0; first < count; first += _block)
+		{
+			std::size_t n = std::min(count - first, _block);
+			curves::simd::sincos(t + first, n, s, c);
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				double e[3], f[3];
+				curves::combine<_type>(k, c[i], s[i], 0.0, e[0], e[1], e[2]);
+				curves::combine<_type>(k, -s[i], c[i], 0.0, f[0], f[1], f[2]);
+				for (std::size_t j = 0; j < 3; ++j)
+				{
+					if (values)
+						values[first + i][j] = e[j] + h[j] * t[first + i];
+					if (d1)
+						d1[first + i][j] = f[j] + h[j];
+					if (d2)
+						d2[first + i][j] = -e[j];
+					if (d3)
+						d3[first + i][j] = -f[j];
+				}
+			}
+		}
+	}
+
+	template <curves::operator_t _type, typename _store>
+	void _sample(const curves::baked_form& k, double t0, double dt, std::size_t n, const _store& store) noexcept
+	{
+		// rotation by dt written as c -= alpha * c + beta * s, s -= alpha * s - beta * c,
+		// alpha = 2 sin^2(dt / 2), which keeps the increment small for small steps
+		double alpha = 2.0 * std::sin(0.5 * dt) * std::sin(0.5 * dt), beta = std::sin(dt);
+		double c = 0.0, s = 0.0;
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			double t = t0 + dt * static_cast<double>(i);
+			if (i % _anchor == 0)
+			{
+				c = std::cos(t);
+				s = std::sin(t);
+			}
+			else
+			{
+				double dc = alpha * c + beta * s, ds = alpha * s - beta * c;
+				c -= dc;
+				s -= ds;
+			}
+			double x, y, z;
+			curves::combine<_type>(k, c, s, t, x, y, z);
+			store(i, x, y, z);
+		}
+	}
+
+	template <typename _store>
+	void _sample(curves::operator_t type, const curves::baked_form& k,
+		double t0, double dt, std::size_t n, const _store& store) noexcept
+	{
+		if (type == curves::IDENTITY || type == curves::DIAGONAL)
+			_sample<curves::DIAGONAL>(k, t0, dt, n, store);
+		else
+			_sample<curves::GENERAL>(k, t0, dt, n, store);
+	}
+}
+
+curves::operator_t curves::classify(const mv::mat3& linear_operator) noexcept
+{
+	if (linear_operator == mv::mat3())
+		return IDENTITY;
+	const mv::mat3& m = linear_operator;
+	if (m[0][1] == 0.0 && m[0][2] == 0.0 && m[1][0] == 0.0 &&
+		m[1][2] == 0.0 && m[2][0] == 0.0 && m[2][1] == 0.0)
+		return DIAGONAL;
+	mv::mat3 gram = mv::transpose(m) * m;
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			if (std::abs(gram[i][j] - (i == j ? 1.0 : 0.0)) > 1e-12)
+				return GENERAL;
+		}
+	}
+	return ORTHOGONAL;
+}
+
+curves::baked_form curves::bake(const mv::mat3& linear_operator, double Rx, double Ry, double h) noexcept
+{
+	baked_form k;
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		k.a[i] = linear_operator[i][0] * Rx;
+		k.b[i] = linear_operator[i][1] * Ry;
+		k.c[i] = linear_operator[i][2] * h;
+	}
+	return k;
+}
+
+curves::interface_curve::interface_curve() 
+	: _op_type(IDENTITY), _baked(bake(_lin_op, 0.0, 0.0, 0.0)) {}
+
+curves::interface_curve::interface_curve(const mv::mat3& mat, double Rx, double Ry, double h) noexcept 
+	: _lin_op(mat), _op_type(classify(mat)), _baked(bake(mat, Rx, Ry, h)) {}
+
+const mv::mat3& curves::interface_curve::get_linear_operator() const noexcept { return _lin_op; }
+
+curves::operator_t curves::interface_curve::get_operator_type() const noexcept { return _op_type; }
+
+const curves::baked_form& curves::interface_curve::get_baked_form() const noexcept { return _baked; }
+
+curves::curve_point curves::interface_curve::get_value(double t) const noexcept
+{ return _combine(std::cos(t), std::sin(t), t); }
+
+curves::curve_point curves::interface_curve::get_d_dt_value(double t) const noexcept
+{ return _combine(-std::sin(t), std::cos(t), 1.0); }
+
+curves::curve_point curves::interface_curve::get_d2_dt2_value(double t) const noexcept
+{ return _combine(-std::cos(t), -std::sin(t), 0.0); }
+
+curves::curve_point curves::interface_curve::get_d3_dt3_value(double t) const noexcept
+{ return _combine(std::sin(t), -std::cos(t), 0.0); }
+
+void curves::interface_curve::get_values(const double* t, std::size_t count, curve_point* values) const noexcept
+{ _batch<true, false>(_op_type, _baked, t, count, values, nullptr); }
+
+void curves::interface_curve::get_values(const double* t, std::size_t count,
+	double* x, double* y, double* z) const noexcept
+{ simd::get_values(_baked, t, count, x, y, z); }
+
+void curves::interface_curve::get_d_dt_values(const double* t, std::size_t count, curve_point* values) const noexcept
+{ _batch<false, true>(_op_type, _baked, t, count, nullptr, values); }
+
+void curves::interface_curve::get_d_dt_values(const double* t, std::size_t count,
+	double* x, double* y, double* z) const noexcept
+{ simd::get_d_dt_values(_baked, t, count, x, y, z); }
+
+void curves::interface_curve::get_value_and_derivative(double t,
+	curve_point& value, curve_point& derivative) const noexcept
+{
+	double c = std::cos(t), s = std::sin(t);
+	value = _combine(c, s, t);
+	derivative = _combine(-s, c, 1.0);
+}
+
+void curves::interface_curve::get_value_and_derivative(const double* t, std::size_t count,
+	curve_point* values, curve_point* derivatives) const noexcept
+{ _batch<true, true>(_op_type, _baked, t, count, values, derivatives); }
+
+void curves::interface_curve::get_value_and_derivative(const double* t, std::size_t count,
+	double* x, double* y, double* z, double* dx, double* dy, double* dz) const noexcept
+{ simd::get_value_and_derivative(_baked, t, count, x, y, z, dx, dy, dz); }
+
+void curves::interface_curve::get_derivatives(const double* t, std::size_t count, curve_point* values,
+	curve_point* d1, curve_point* d2, curve_point* d3) const noexcept
+{
+	if (_op_type == IDENTITY || _op_type == DIAGONAL)
+		_derivatives<DIAGONAL>(_baked, t, count, values, d1, d2, d3);
+	else
+		_derivatives<GENERAL>(_baked, t, count, values, d1, d2, d3);
+}
+
+void curves::interface_curve::sample_uniform(double t0, double dt, std::size_t n,
+	curve_point* values) const noexcept
+{
+	_sample(_op_type, _baked, t0, dt, n, [values](std::size_t i, double x, double y, double z)
+		{ values[i][0] = x; values[i][1] = y; values[i][2] = z; });
+}
+
+void curves::interface_curve::sample_uniform(double t0, double dt, std::size_t n,
+	double* x, double* y, double* z) const noexcept
+{
+	_sample(_op_type, _baked, t0, dt, n, [x, y, z](std::size_t i, double vx, double vy, double vz)
+		{ x[i] = vx; y[i] = vy; z[i] = vz; });
+}
 
 curves::circle::circle(double R, const mv::mat3& linear_operator) noexcept
-	: _R(R), interface_curve(linear_operator) {}
+	: interface_curve(linear_operator, R, R, 0.0), _R(R) {}
 
 double curves::circle::get_radius() const noexcept { return _R; }
 
-curves::curve_point curves::circle::get_value(double t) const noexcept
-{ return _lin_op * mv::vec3(_R * std::cos(t), _R * std::sin(t), 0.0); }
-
-curves::curve_point curves::circle::get_d_dt_value(double t) const noexcept
-{ return _lin_op * mv::vec3(_R * (-std::sin(t)), _R * std::cos(t), 0.0); }
+curves::curve_t curves::circle::get_type() const noexcept { return CIRCLE; }
 
 curves::ellipse::ellipse(double Rx, double Ry, const mv::mat3& linear_operator) noexcept
-	: _Rx(Rx), _Ry(Ry), interface_curve(linear_operator) {}
+	: interface_curve(linear_operator, Rx, Ry, 0.0), _Rx(Rx), _Ry(Ry) {}
+
+double curves::ellipse::get_radius_x() const noexcept { return _Rx; }
 
-curves::curve_point curves::ellipse::get_value(double t) const noexcept
-{ return _lin_op * mv::vec3(_Rx * std::cos(t), _Ry * std::sin(t), 0.0); }
+double curves::ellipse::get_radius_y() const noexcept { return _Ry; }
 
-curves::curve_point curves::ellipse::get_d_dt_value(double t) const noexcept
-{ return _lin_op * mv::vec3(_Rx * (-std::sin(t)), _Ry * std::cos(t), 0.0); }
+curves::curve_t curves::ellipse::get_type() const noexcept { return ELLIPSE; }
 
 curves::helix::helix(double R, double h, const mv::mat3& linear_operator) noexcept
-	: _R(R), _h(h), interface_curve(linear_operator) {}
+	: interface_curve(linear_operator, R, R, h), _R(R), _h(h) {}
 
-curves::curve_point curves::helix::get_value(double t) const noexcept
-{ return _lin_op * mv::vec3(_R * std::cos(t), _R * std::sin(t), _h * t); }
+double curves::helix::get_radius() const noexcept { return _R; }
 
-curves::curve_point curves::helix::get_d_dt_value(double t) const noexcept
-{ return _lin_op * mv::vec3(_R * (-std::sin(t)), _R * std::cos(t), _h); }
+double curves::helix::get_step() const noexcept { return _h; }
+
+curves::curve_t curves::helix::get_type() const noexcept { return HELIX; }
 
 curves::curve_builder::build_exception::build_exception(const char* what) noexcept
 	: what(what) {}
+
+curves::storage_exception::storage_exception(const char* what) noexcept
+	: what(what) {}
@@ -7,8 +7,11 @@
 #define DLL_API __declspec(dllimport)
 #endif
 
+#include <cmath>
 #include <random>
 #include <memory>
+#include <memory_resource>
+#include <variant>
 
 #include "matvec.hpp"
 
@@ -18,18 +21,110 @@ namespace curves
 {
 	using curve_point = mv::vec3;
 
+	enum curve_t { CIRCLE = 0, ELLIPSE = 1, HELIX = 2 };
+
+	// IDENTITY and DIAGONAL operators are applied on the axes (see combine). ORTHOGONAL is
+	// informational only: such operators preserve lengths and angles, but once baked they cost
+	// the same full product as GENERAL, which is the path they take.
+	enum operator_t { IDENTITY = 0, DIAGONAL = 1, ORTHOGONAL = 2, GENERAL = 3 };
+
+	DLL_API operator_t classify(const mv::mat3& linear_operator) noexcept;
+
+	// Curve parameters folded into the columns of the linear operator:
+	// p(t) = a * cos(t) + b * sin(t) + c * t, where a = Rx * col0, b = Ry * col1, c = h * col2.
+	// Any derivative is the same combination weighted by the derivatives of cos(t), sin(t) and t.
+	struct baked_form
+	{
+		double a[3], b[3], c[3];
+	};
+
+	DLL_API baked_form bake(const mv::mat3& linear_operator, double Rx, double Ry, double h) noexcept;
+
+	// Identity and diagonal operators keep a, b and c on the axes, so only the diagonal terms are used.
+	template <operator_t _type>
+	void combine(const baked_form& k, double wa, double wb, double wc,
+		double& x, double& y, double& z) noexcept
+	{
+		if constexpr (_type == IDENTITY || _type == DIAGONAL)
+		{
+			x = k.a[0] * wa;
+			y = k.b[1] * wb;
+			z = k.c[2] * wc;
+		}
+		else
+		{
+			x = k.a[0] * wa + k.b[0] * wb + k.c[0] * wc;
+			y = k.a[1] * wa + k.b[1] * wb + k.c[1] * wc;
+			z = k.a[2] * wa + k.b[2] * wb + k.c[2] * wc;
+		}
+	}
+
+	inline void combine(operator_t type, const baked_form& k, double wa, double wb, double wc,
+		double& x, double& y, double& z) noexcept
+	{
+		if (type == IDENTITY || type == DIAGONAL)
+			combine<DIAGONAL>(k, wa, wb, wc, x, y, z);
+		else
+			combine<GENERAL>(k, wa, wb, wc, x, y, z);
+	}
+
+	class curve_value;
+
 	class interface_curve
 	{
+		friend class curve_value;
 	protected:
 		mv::mat3 _lin_op;
+		operator_t _op_type;
+		baked_form _baked;
 		DLL_API interface_curve();
-		DLL_API explicit interface_curve(const mv::mat3& mat) noexcept;
+		// bakes the operator with the radii and step of the derived curve
+		DLL_API interface_curve(const mv::mat3& mat, double Rx, double Ry, double h) noexcept;
+
+		curve_point _combine(double wa, double wb, double wc) const noexcept
+		{
+			curve_point result;
+			combine(_op_type, _baked, wa, wb, wc, result[0], result[1], result[2]);
+			return result;
+		}
 	public:
-		curve_point virtual get_value(double) const noexcept = 0;
-		curve_point virtual get_d_dt_value(double) const noexcept = 0;
+		DLL_API const mv::mat3& get_linear_operator() const noexcept;
+		DLL_API operator_t get_operator_type() const noexcept;
+		DLL_API const baked_form& get_baked_form() const noexcept;
+		curve_t virtual get_type() const noexcept = 0;
+
+		DLL_API curve_point get_value(double t) const noexcept;
+		DLL_API curve_point get_d_dt_value(double t) const noexcept;
+		DLL_API curve_point get_d2_dt2_value(double t) const noexcept;
+		DLL_API curve_point get_d3_dt3_value(double t) const noexcept;
+
+		DLL_API void get_values(const double* t, std::size_t count, curve_point* values) const noexcept;
+		DLL_API void get_values(const double* t, std::size_t count, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values(const double* t, std::size_t count, curve_point* values) const noexcept;
+		DLL_API void get_d_dt_values(const double* t, std::size_t count, double* x, double* y, double* z) const noexcept;
+
+		DLL_API void get_value_and_derivative(double t, curve_point& value, curve_point& derivative) const noexcept;
+		DLL_API void get_value_and_derivative(const double* t, std::size_t count,
+			curve_point* values, curve_point* derivatives) const noexcept;
+		DLL_API void get_value_and_derivative(const double* t, std::size_t count,
+			double* x, double* y, double* z, double* dx, double* dy, double* dz) const noexcept;
+
+		// Value and the first three derivatives; any output may be null. With e = a cos t + b sin t
+		// and f = b cos t - a sin t they are e + c t, f + c, -e and -f, so each parameter takes one
+		// sincos (simd::sincos over blocks) and two operator products.
+		DLL_API void get_derivatives(const double* t, std::size_t count, curve_point* values,
+			curve_point* d1, curve_point* d2, curve_point* d3) const noexcept;
+
+		// Samples t0 + k * dt, k < n, advancing cos/sin by a rotation recurrence that is
+		// re-anchored to std::cos/std::sin every 64 samples. Between anchors the recurrence adds
+		// at most 64 * 4 * DBL_EPSILON (about 6e-14) to (cos t, sin t), on top of the |t| DBL_EPSILON
+		// by which t0 + k * dt is itself rounded, so points are accurate to that factor of |a| + |b|
+		// of the baked form.
+		DLL_API void sample_uniform(double t0, double dt, std::size_t n, curve_point* values) const noexcept;
+		DLL_API void sample_uniform(double t0, double dt, std::size_t n, double* x, double* y, double* z) const noexcept;
 	};
 
-	class circle : public interface_curve
+	class circle final : public interface_curve
 	{
 	private:
 		double _R;
@@ -37,33 +132,83 @@ namespace curves
 		friend class curve_builder;
 	public:
 		DLL_API double get_radius() const noexcept;
-		DLL_API curve_point get_value(double t) const noexcept override;
-		DLL_API curve_point get_d_dt_value(double t) const noexcept override;
+		DLL_API curve_t get_type() const noexcept override;
 	};
 
-	class ellipse : public interface_curve
+	class ellipse final : public interface_curve
 	{
 	private:
 		double _Rx, _Ry;
 		DLL_API ellipse(double Rx, double Ry, const mv::mat3& linear_operator = mv::mat3()) noexcept;
 		friend class curve_builder;
 	public:
-		DLL_API curve_point get_value(double t) const noexcept override;
-		DLL_API curve_point get_d_dt_value(double t) const noexcept override;
+		DLL_API double get_radius_x() const noexcept;
+		DLL_API double get_radius_y() const noexcept;
+		DLL_API curve_t get_type() const noexcept override;
 	};
 
-	class helix : public interface_curve
+	class helix final : public interface_curve
 	{
 	private:
 		double _R, _h;
 		DLL_API helix(double R, double h, const mv::mat3& linear_operator = mv::mat3()) noexcept;
 		friend class curve_builder;
 	public:
-		DLL_API curve_point get_value(double t) const noexcept override;
-		DLL_API curve_point get_d_dt_value(double t) const noexcept override;
+		DLL_API double get_radius() const noexcept;
+		DLL_API double get_step() const noexcept;
+		DLL_API curve_t get_type() const noexcept override;
 	};
 
-	enum curve_t { CIRCLE = 0, ELLIPSE = 1, HELIX = 2 };
+	// Value-semantic closed-set curve: the alternative is resolved by visitation on the
+	// stored index (the curve classes are final), so no vtable or RTTI is involved. The scalar
+	// evaluators combine the baked form here in the header, so they inline into the caller; the
+	// batch ones call the SIMD kernels of the library once per array.
+	class curve_value final
+	{
+	private:
+		std::variant<circle, ellipse, helix> _curve;
+	public:
+		curve_value(const circle& curve) noexcept : _curve(curve) {}
+		curve_value(const ellipse& curve) noexcept : _curve(curve) {}
+		curve_value(const helix& curve) noexcept : _curve(curve) {}
+
+		curve_t get_type() const noexcept { return static_cast<curve_t>(_curve.index()); }
+
+		template <typename _curve_type>
+		const _curve_type* get_if() const noexcept { return std::get_if<_curve_type>(&_curve); }
+
+		template <typename _visitor>
+		decltype(auto) visit(_visitor&& visitor) const
+		{ return std::visit(std::forward<_visitor>(visitor), _curve); }
+
+		curve_point get_value(double t) const noexcept
+		{
+			return std::visit([t](const interface_curve& curve)
+				{ return curve._combine(std::cos(t), std::sin(t), t); }, _curve);
+		}
+
+		curve_point get_d_dt_value(double t) const noexcept
+		{
+			return std::visit([t](const interface_curve& curve)
+				{ return curve._combine(-std::sin(t), std::cos(t), 1.0); }, _curve);
+		}
+
+		void get_value_and_derivative(double t, curve_point& value, curve_point& derivative) const noexcept
+		{
+			std::visit([&](const interface_curve& curve)
+			{
+				double c = std::cos(t), s = std::sin(t);
+				value = curve._combine(c, s, t);
+				derivative = curve._combine(-s, c, 1.0);
+			}, _curve);
+		}
+
+		void get_values(const double* t, std::size_t count, double* x, double* y, double* z) const noexcept
+		{ std::visit([&](const auto& curve) { curve.get_values(t, count, x, y, z); }, _curve); }
+
+		void get_d_dt_values(const double* t, std::size_t count, double* x, double* y, double* z) const noexcept
+		{ std::visit([&](const auto& curve) { curve.get_d_dt_values(t, count, x, y, z); }, _curve); }
+	};
 
 	class curve_builder final
 	{
@@ -75,6 +220,17 @@ namespace curves
 		static bool _valid(const mv::mat3& linear_operator) noexcept { return true; }
 		static bool _valid() noexcept { return true; }
 
+		template <typename _curve, typename ..._args>
+		static std::shared_ptr<interface_curve> _allocate(
+			std::pmr::memory_resource* resource, const _args&... construct_data)
+		{
+			void* memory = resource->allocate(sizeof(_curve), alignof(_curve));
+			_curve* curve = new (memory) _curve(construct_data...);
+			return std::shared_ptr<interface_curve>(curve,
+				[resource](_curve* p) { p->~_curve(); resource->deallocate(p, sizeof(_curve), alignof(_curve)); },
+				std::pmr::polymorphic_allocator<_curve>(resource));
+		}
+
 #define RAND_GEN std::rand() % 50 + 1
 	public:
 		using curve_ptr = std::shared_ptr<interface_curve>;
@@ -99,6 +255,54 @@ namespace curves
 			static_assert(curve < 3, "Uncorrect curve type");
 		}
 
+		// Allocator-aware overloads: the curve and its control block both come from resource.
+		// With a std::pmr::monotonic_buffer_resource a whole population lives in one arena and
+		// is released at once; the resource must outlive every pointer built from it.
+		template <curve_t curve, typename ..._args>
+		static curve_ptr allocate_curve(std::pmr::memory_resource* resource, _args... construct_data)
+		{
+			if (!_valid(construct_data...))
+				throw build_exception("Curve is not physically correct");
+			if constexpr (curve == CIRCLE)
+				return _allocate<circle>(resource, construct_data...);
+			else if constexpr (curve == ELLIPSE)
+				return _allocate<ellipse>(resource, construct_data...);
+			else
+			{
+				static_assert(curve == HELIX, "Uncorrect curve type");
+				return _allocate<helix>(resource, construct_data...);
+			}
+		}
+
+		template <curve_t curve, typename ..._args>
+		static curve_value make_value(_args... construct_data)
+		{
+			if (!_valid(construct_data...))
+				throw build_exception("Curve is not physically correct");
+			if constexpr (curve == CIRCLE)
+				return circle(construct_data...);
+			else if constexpr (curve == ELLIPSE)
+				return ellipse(construct_data...);
+			else
+			{
+				static_assert(curve == HELIX, "Uncorrect curve type");
+				return helix(construct_data...);
+			}
+		}
+
+		static curve_value make_value(const interface_curve& curve) noexcept
+		{
+			switch (curve.get_type())
+			{
+			case ELLIPSE:
+				return static_cast<const ellipse&>(curve);
+			case HELIX:
+				return static_cast<const helix&>(curve);
+			default:
+				return static_cast<const circle&>(curve);
+			}
+		}
+
 		static curve_ptr make_random_curve() noexcept
 		{
 			curve_t curve = static_cast<curve_t>(std::rand() % 3);
@@ -129,6 +333,39 @@ namespace curves
 				return curve_ptr(new helix(RAND_GEN, RAND_GEN, random_linear_operator));
 			}
 		}
+
+		static curve_ptr make_random_curve(std::pmr::memory_resource* resource)
+		{
+			curve_t curve = static_cast<curve_t>(std::rand() % 3);
+			switch (curve)
+			{
+			case CIRCLE:
+				return _allocate<circle>(resource, RAND_GEN);
+			case ELLIPSE:
+				return _allocate<ellipse>(resource, RAND_GEN, RAND_GEN);
+			case HELIX:
+				return _allocate<helix>(resource, RAND_GEN, RAND_GEN);
+			}
+			throw build_exception("Unknown curve type");
+		}
+
+		static curve_ptr make_random_curve_with_random_linear_operator(std::pmr::memory_resource* resource)
+		{
+			curve_t curve = static_cast<curve_t>(std::rand() % 3);
+			mv::mat3 random_linear_operator;
+			for (auto i = random_linear_operator.begin();
+				i != random_linear_operator.end(); *i = RAND_GEN, ++i);
+			switch (curve)
+			{
+			case CIRCLE:
+				return _allocate<circle>(resource, RAND_GEN, random_linear_operator);
+			case ELLIPSE:
+				return _allocate<ellipse>(resource, RAND_GEN, RAND_GEN, random_linear_operator);
+			case HELIX:
+				return _allocate<helix>(resource, RAND_GEN, RAND_GEN, random_linear_operator);
+			}
+			throw build_exception("Unknown curve type");
+		}
 	};
 }
 
@@ -0,0 +1,16 @@
+#ifndef _CAD_EXCEPTIONS
+#define _CAD_EXCEPTIONS
+
+#include "curves.hpp"
+
+namespace curves
+{
+	// File and stream failures of the binary container and the text writer.
+	struct storage_exception
+	{
+		const char* what;
+		DLL_API explicit storage_exception(const char* what) noexcept;
+	};
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "frames.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using curves::numeric::dot;
+	using curves::numeric::cross;
+
+	constexpr std::size_t _block = 256;
+
+	curves::curve_point _scaled(const curves::curve_point& a, double factor) noexcept
+	{
+		curves::curve_point r;
+		for (std::size_t i = 0; i < 3; ++i)
+			r[i] = a[i] * factor;
+		return r;
+	}
+
+	// a - 2 (v.a) / (v.v) v, the reflection of a through the plane across v
+	curves::curve_point _reflect(const curves::curve_point& a, const curves::curve_point& v, double vv) noexcept
+	{
+		curves::curve_point r;
+		double f = 2.0 * dot(v.ptr(), a.ptr()) / vv;
+		for (std::size_t i = 0; i < 3; ++i)
+			r[i] = a[i] - f * v[i];
+		return r;
+	}
+
+	void _frenet(const curves::curve_point& d1, const curves::curve_point& d2, const curves::curve_point& d3,
+		curves::frame* f, double* curvature, double* torsion) noexcept
+	{
+		curves::curve_point b;
+		cross(d1.ptr(), d2.ptr(), &b[0]);
+		double vv = dot(d1.ptr(), d1.ptr()), bb = dot(b.ptr(), b.ptr()), speed = std::sqrt(vv), bl = std::sqrt(bb);
+		if (f)
+		{
+			f->tangent = _scaled(d1, speed > 0.0 ? 1.0 / speed : 0.0);
+			f->binormal = _scaled(b, bl > 0.0 ? 1.0 / bl : 0.0);
+			cross(f->binormal.ptr(), f->tangent.ptr(), &f->normal[0]);
+		}
+		if (curvature)
+			*curvature = bl > 0.0 ? bl / (vv * speed) : 0.0;
+		if (torsion)
+			*torsion = bb > 0.0 ? dot(b.ptr(), d3.ptr()) / bb : 0.0;
+	}
+
+	// some unit vector across the unit tangent u
+	curves::curve_point _across(const curves::curve_point& u) noexcept
+	{
+		std::size_t axis = 0;
+		for (std::size_t i = 1; i < 3; ++i)
+			if (std::abs(u[i]) < std::abs(u[axis]))
+				axis = i;
+		// the axis least along u, less its part along u
+		curves::curve_point r = _scaled(u, -u[axis]);
+		r[axis] += 1.0;
+		return _scaled(r, 1.0 / std::sqrt(dot(r.ptr(), r.ptr())));
+	}
+
+	// Calls visit(i, p, d1, d2, d3) for every parameter, evaluating the derivatives a block at a time.
+	template <typename _visit>
+	void _jets(const curves::interface_curve& curve, const double* t, std::size_t count, const _visit& visit)
+	{
+		curves::curve_point p[_block], d1[_block], d2[_block], d3[_block];
+		for (std::size_t first = 0; first < count; first += _block)
+		{
+			std::size_t n = std::min(count - first, _block);
+			curve.get_derivatives(t + first, n, p, d1, d2, d3);
+			for (std::size_t i = 0; i < n; ++i)
+				visit(first + i, p[i], d1[i], d2[i], d3[i]);
+		}
+	}
+}
+
+double curves::curvature(const interface_curve& curve, double t) noexcept
+{
+	double result;
+	_frenet(curve.get_d_dt_value(t), curve.get_d2_dt2_value(t), curve.get_d3_dt3_value(t), nullptr, &result, nullptr);
+	return result;
+}
+
+double curves::torsion(const interface_curve& curve, double t) noexcept
+{
+	double result;
+	_frenet(curve.get_d_dt_value(t), curve.get_d2_dt2_value(t), curve.get_d3_dt3_value(t), nullptr, nullptr, &result);
+	return result;
+}
+
+curves::frame curves::frenet_frame(const interface_curve& curve, double t) noexcept
+{
+	frame result;
+	_frenet(curve.get_d_dt_value(t), curve.get_d2_dt2_value(t), curve.get_d3_dt3_value(t), &result, nullptr, nullptr);
+	return result;
+}
+
+void curves::frenet_frames(const interface_curve& curve, const double* t, std::size_t count,
+	curve_point* points, frame* frames, double* curvature, double* torsion) noexcept
+{
+	_jets(curve, t, count, [=](std::size_t i, const curve_point& p, const curve_point& d1,
+		const curve_point& d2, const curve_point& d3)
+	{
+		if (points)
+			points[i] = p;
+		_frenet(d1, d2, d3, frames ? frames + i : nullptr,
+			curvature ? curvature + i : nullptr, torsion ? torsion + i : nullptr);
+	});
+}
+
+void curves::transport_frames(const interface_curve& curve, const double* t, std::size_t count,
+	curve_point* points, frame* frames) noexcept
+{
+	curve_point previous, tangent, normal;
+	_jets(curve, t, count, [&](std::size_t i, const curve_point& p, const curve_point& d1,
+		const curve_point& d2, const curve_point& d3)
+	{
+		double vv = dot(d1.ptr(), d1.ptr());
+		curve_point next = vv > 0.0 ? _scaled(d1, 1.0 / std::sqrt(vv)) : tangent;
+		if (i == 0)
+		{
+			frame f;
+			_frenet(d1, d2, d3, &f, nullptr, nullptr);
+			normal = dot(f.normal.ptr(), f.normal.ptr()) > 0.0 ? f.normal : _across(next);
+		}
+		else
+		{
+			curve_point v = p;
+			for (std::size_t j = 0; j < 3; ++j)
+				v[j] -= previous[j];
+			double c1 = dot(v.ptr(), v.ptr());
+			curve_point r = normal, u = tangent;
+			if (c1 > 0.0)
+			{
+				r = _reflect(normal, v, c1);
+				u = _reflect(tangent, v, c1);
+			}
+			for (std::size_t j = 0; j < 3; ++j)
+				v[j] = next[j] - u[j];
+			double c2 = dot(v.ptr(), v.ptr());
+			normal = c2 > 0.0 ? _reflect(r, v, c2) : r;
+		}
+		previous = p;
+		tangent = next;
+		if (points)
+			points[i] = p;
+		frames[i].tangent = tangent;
+		frames[i].normal = normal;
+		cross(tangent.ptr(), normal.ptr(), &frames[i].binormal[0]);
+	});
+}
@@ -0,0 +1,36 @@
+#ifndef _CAD_FRAMES
+#define _CAD_FRAMES
+
+#include "curves.hpp"
+
+namespace curves
+{
+	// Unit tangent, normal and binormal, binormal = tangent x normal.
+	struct frame
+	{
+		curve_point tangent, normal, binormal;
+	};
+
+	// Curvature |P' x P''| / |P'|^3 and torsion (P' x P'').P''' / |P' x P''|^2 from the analytic
+	// derivatives. Where P' x P'' vanishes (a stalled or locally straight curve) the Frenet normal
+	// and binormal are zero, and so are curvature and torsion.
+	DLL_API double curvature(const interface_curve& curve, double t) noexcept;
+	DLL_API double torsion(const interface_curve& curve, double t) noexcept;
+	DLL_API frame frenet_frame(const interface_curve& curve, double t) noexcept;
+
+	// Frenet frames with the points they sit on, sharing one sincos and two operator products per
+	// parameter with the position; points, curvature and torsion may be null.
+	DLL_API void frenet_frames(const interface_curve& curve, const double* t, std::size_t count,
+		curve_point* points, frame* frames, double* curvature = nullptr, double* torsion = nullptr) noexcept;
+
+	// Rotation-minimizing frames along t, carried from sample to sample by the double reflection
+	// method: a reflection through the bisecting plane of the two points, then one that takes
+	// the reflected tangent onto the next tangent. The first normal is the Frenet normal, or any
+	// unit vector across the tangent where that is undefined. Unlike Frenet frames they do not
+	// flip at inflections or spin on near-straight stretches; the rotation they miss against the
+	// exact transport falls with the fourth power of the spacing.
+	DLL_API void transport_frames(const interface_curve& curve, const double* t, std::size_t count,
+		curve_point* points, frame* frames) noexcept;
+}
+
+#endif
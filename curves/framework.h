@@ -1,5 +1,6 @@
 ﻿#pragma once
 
 #define WIN32_LEAN_AND_MEAN             // Исключите редко используемые компоненты из заголовков Windows
+#define NOMINMAX                        // std::min и std::max вместо макросов min и max из windows.h
 // Файлы заголовков Windows
 #include <windows.h>
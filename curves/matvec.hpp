@@ -435,8 +435,8 @@ namespace mv
 	bool operator!=(const matrix<_type, _row, _column>& A,
 		const matrix<_type, _row, _column>& B) noexcept { return !(A == B); }
 
-	double rad(double deg_angle) noexcept { return deg_angle * (std::acos(-1.0) / 180.0); }
-	double deg(double rad_angle) noexcept { return rad_angle * 180.0 / std::acos(-1.0);   }
+	inline double rad(double deg_angle) noexcept { return deg_angle * (std::acos(-1.0) / 180.0); }
+	inline double deg(double rad_angle) noexcept { return rad_angle * 180.0 / std::acos(-1.0);   }
 
 	template <typename _type, std::size_t _dim>
 	vector<_type, _dim> rad(vector<_type, _dim> vec_of_deg_angle) noexcept
@@ -0,0 +1,56 @@
+#ifndef _CAD_NUMERIC
+#define _CAD_NUMERIC
+
+#include <cmath>
+#include <cstddef>
+
+// Helpers shared by the geometric queries; internal to the library, nothing here is exported.
+namespace curves
+{
+	namespace numeric
+	{
+		constexpr double pi = 3.14159265358979323846;
+		constexpr double two_pi = 2.0 * pi;
+
+		inline double dot(const double* a, const double* b) noexcept { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+		inline void cross(const double* a, const double* b, double* r) noexcept
+		{
+			r[0] = a[1] * b[2] - a[2] * b[1];
+			r[1] = a[2] * b[0] - a[0] * b[2];
+			r[2] = a[0] * b[1] - a[1] * b[0];
+		}
+
+		// Root of a function rising through zero inside [lo, hi]. evaluate(t, slope) returns the
+		// value at t and sets its slope; the value moves one end of the bracket to t, and Newton
+		// steps that leave the bracket or lack a positive slope bisect. Returns the last point
+		// evaluated and sets step to the Newton step still due from it, which is zero or below
+		// 1e-8 (1 + |t|): convergence is quadratic, so that step lands at rounding.
+		template <typename _evaluate>
+		double newton(const _evaluate& evaluate, double t, double lo, double hi, double& step)
+		{
+			for (std::size_t i = 0; ; ++i)
+			{
+				double slope, value = evaluate(t, slope);
+				step = 0.0;
+				if (value == 0.0 || i == 63)
+					return t;
+				if (value > 0.0)
+					hi = t;
+				else
+					lo = t;
+				double next = slope > 0.0 ? t - value / slope : 0.5 * (lo + hi);
+				if (!(next >= lo && next <= hi))
+					next = 0.5 * (lo + hi);
+				if (slope > 0.0 && std::abs(next - t) <= 1e-8 * (1.0 + std::abs(t)))
+				{
+					step = next - t;
+					return t;
+				}
+				t = next;
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "pch.h"
+#include "picking.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using curves::numeric::pi;
+	using curves::numeric::two_pi;
+	using curves::numeric::dot;
+	using curves::numeric::cross;
+
+	const double _step = pi / 8.0;
+
+	// unit direction and the length it was scaled by
+	double _unit(const curves::ray& r, double* u) noexcept
+	{
+		double length = std::sqrt(dot(r.direction, r.direction));
+		for (std::size_t i = 0; i < 3; ++i)
+			u[i] = r.direction[i] / length;
+		return length;
+	}
+
+	// Squared distance from P(t) to the ray: to the line ahead of the origin, to the origin
+	// behind it. The two branches agree to first order at s = 0, so g' is continuous.
+	struct _ray_distance
+	{
+		const curves::baked_form& k;
+		const double* o;
+		const double* u;
+		// refinements stay within [first, last]
+		double first, last;
+
+		// returns g = D^2 / 2, sets g' and g''
+		double operator()(double t, double& slope, double& curvature) const noexcept
+		{
+			double c = std::cos(t), s = std::sin(t), w[3], d[3], dd[3];
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				dd[i] = -(k.a[i] * c + k.b[i] * s);
+				w[i] = -dd[i] + k.c[i] * t - o[i];
+				d[i] = -k.a[i] * s + k.b[i] * c + k.c[i];
+			}
+			double g = 0.5 * dot(w, w);
+			slope = dot(w, d);
+			curvature = dot(d, d) + dot(w, dd);
+			double along = dot(w, u);
+			if (along > 0.0)
+			{
+				double du = dot(d, u);
+				g -= 0.5 * along * along;
+				slope -= along * du;
+				curvature -= du * du + along * dot(dd, u);
+			}
+			return g;
+		}
+
+		double operator()(double t) const noexcept
+		{
+			double slope, curvature;
+			return (*this)(t, slope, curvature);
+		}
+
+		// bracketed Newton on g' as in the closest-point refinement
+		double refine(double t, double lo, double hi, double& g) const noexcept
+		{
+			lo = std::max(lo, first);
+			hi = std::min(hi, last);
+			double step;
+			t = curves::numeric::newton([this, &g](double x, double& curvature)
+			{
+				double slope;
+				g = (*this)(x, slope, curvature);
+				return slope;
+			}, std::min(std::max(t, lo), hi), lo, hi, step);
+			return t + step;
+		}
+
+		// Samples [t0, t1] framed by one step each side and refines every discrete minimum that
+		// can still beat the best: D moves by at most step * speed between samples. The ends of
+		// the range are left to the caller.
+		void scan(double t0, double t1, double speed, double& best_t, double& best_g) const noexcept
+		{
+			if (!(t1 > t0))
+				return;
+			std::size_t n = std::max<std::size_t>(static_cast<std::size_t>(std::ceil((t1 - t0) / _step)), 1) + 3;
+			double h = (t1 - t0) / static_cast<double>(n - 3), drift = h * speed;
+			double previous = HUGE_VAL, current = HUGE_VAL;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				double t = t0 + h * (static_cast<double>(i) - 1.0), next = (*this)(t);
+				if (i > 1 && current <= previous && current <= next)
+				{
+					double floor = std::sqrt(2.0 * current) - drift;
+					if (floor <= 0.0 || 0.5 * floor * floor < best_g)
+					{
+						double middle = t - h, bend = previous - 2.0 * current + next;
+						double start = bend > 0.0 ? middle + 0.5 * h * (previous - next) / bend : middle;
+						double g, refined = refine(start, middle - h, middle + h, g);
+						if (g < best_g)
+						{
+							best_g = g;
+							best_t = refined;
+						}
+					}
+				}
+				previous = current;
+				current = next;
+			}
+		}
+	};
+
+	curves::ray_approach _approach(const curves::baked_form& k, const curves::ray& r, const double* u, double length,
+		double t) noexcept
+	{
+		curves::ray_approach result;
+		result.t = t;
+		curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t,
+			result.point[0], result.point[1], result.point[2]);
+		double w[3] = { result.point[0] - r.origin[0], result.point[1] - r.origin[1], result.point[2] - r.origin[2] };
+		double along = dot(w, u);
+		result.s = along / length;
+		if (along > 0.0)
+			for (std::size_t i = 0; i < 3; ++i)
+				w[i] -= along * u[i];
+		result.distance = std::sqrt(dot(w, w));
+		return result;
+	}
+
+	// Over [t0, t1]: the ends, then, when c is not along the ray, the parameter abreast of the
+	// origin and the window the best value so far still allows. A finite limit on g = D^2 / 2
+	// narrows the window from the start and returns false, without evaluating the curve, when
+	// the bounds below already exceed it.
+	bool _search(const curves::baked_form& k, const curves::ray& r, double t0, double t1, double limit,
+		curves::ray_approach& result) noexcept
+	{
+		double u[3], length = _unit(r, u);
+		_ray_distance g{ k, r.origin, u, t0, t1 };
+		double best_t = t0, best_g = HUGE_VAL, lo = t0, hi = t1;
+		auto consider = [&g, &best_t, &best_g](double t)
+		{
+			double value = g(t);
+			if (value < best_g)
+			{
+				best_g = value;
+				best_t = t;
+			}
+		};
+
+		// Across the ray along w, the direction of c seen from the ray, P moves by rate per unit t
+		// plus an oscillation of at most reach; along v = u x w it only oscillates. D is at least
+		// either distance.
+		double w[3], cu = dot(k.c, u), reach = 0.0, center = 0.0;
+		for (std::size_t i = 0; i < 3; ++i)
+			w[i] = k.c[i] - cu * u[i];
+		double rate = std::sqrt(dot(w, w));
+		bool bounded = rate > 1e-12 * std::sqrt(dot(k.c, k.c));
+		if (bounded)
+		{
+			double v[3];
+			for (std::size_t i = 0; i < 3; ++i)
+				w[i] /= rate;
+			cross(u, w, v);
+			double offset = std::abs(dot(r.origin, v)) - std::hypot(dot(k.a, v), dot(k.b, v));
+			if (offset > 0.0 && 0.5 * offset * offset > limit)
+				return false;
+			reach = std::hypot(dot(k.a, w), dot(k.b, w));
+			center = dot(r.origin, w) / rate;
+			if (limit < HUGE_VAL)
+			{
+				double width = (std::sqrt(2.0 * limit) + reach) / rate;
+				lo = std::max(lo, center - width);
+				hi = std::min(hi, center + width);
+				if (lo > hi)
+					return false;
+			}
+			consider(std::min(std::max(center, lo), hi));
+		}
+		consider(lo);
+		consider(hi);
+		best_g = std::min(best_g, limit);
+		if (bounded)
+		{
+			double width = (std::sqrt(2.0 * best_g) + reach) / rate;
+			lo = std::max(lo, center - width);
+			hi = std::min(hi, center + width);
+		}
+		double speed = std::sqrt(dot(k.a, k.a)) + std::sqrt(dot(k.b, k.b)) + std::sqrt(dot(k.c, k.c));
+		g.scan(lo, hi, speed, best_t, best_g);
+		result = _approach(k, r, u, length, best_t);
+		return true;
+	}
+
+	// In the coordinates x = alpha a + beta b of its plane a curve a cos t + b sin t is the unit
+	// circle, and a point within tolerance of it lies within tolerance of the plane with
+	// alpha^2 + beta^2 between (1 - tolerance / B)^2 and (1 + tolerance / B)^2, B the minor
+	// semi-axis: the scaled ellipses stay at least (scale - 1) * B away. False when the part of
+	// the ray inside that slab misses the band.
+	bool _near_ring(const curves::baked_form& k, const curves::ray& r, const double* u, double tolerance) noexcept
+	{
+		double n[3];
+		cross(k.a, k.b, n);
+		double nn = std::sqrt(dot(n, n));
+		if (nn == 0.0)
+			return true;
+		for (std::size_t i = 0; i < 3; ++i)
+			n[i] /= nn;
+		double aa = dot(k.a, k.a), bb = dot(k.b, k.b), ab = dot(k.a, k.b), det = aa * bb - ab * ab;
+		double minor = std::sqrt(std::max(0.5 * (aa + bb) - std::hypot(0.5 * (aa - bb), ab), 0.0));
+		if (!(det > 0.0) || minor <= tolerance)
+			return true;
+		double outer = 1.0 + tolerance / minor, inner = 1.0 - tolerance / minor;
+
+		// s in world units along u: the slab |n.x| <= tolerance, clipped to s >= 0
+		double height = dot(n, r.origin), rate = dot(n, u), s0 = 0.0, s1 = HUGE_VAL;
+		if (std::abs(rate) > 1e-12)
+		{
+			double e0 = (-tolerance - height) / rate, e1 = (tolerance - height) / rate;
+			s0 = std::max(std::min(e0, e1), 0.0);
+			s1 = std::max(e0, e1);
+			if (s1 < s0)
+				return false;
+		}
+		else if (std::abs(height) > tolerance)
+			return false;
+
+		// (alpha, beta) = G^-1 (a.x, b.x) is affine in s, so alpha^2 + beta^2 is a convex quadratic
+		double pa = dot(k.a, r.origin), pb = dot(k.b, r.origin), da = dot(k.a, u), db = dot(k.b, u);
+		double alpha0 = (bb * pa - ab * pb) / det, beta0 = (aa * pb - ab * pa) / det;
+		double alpha1 = (bb * da - ab * db) / det, beta1 = (aa * db - ab * da) / det;
+		double q2 = alpha1 * alpha1 + beta1 * beta1, q1 = alpha0 * alpha1 + beta0 * beta1, q0 = alpha0 * alpha0 + beta0 * beta0;
+		auto q = [q0, q1, q2](double s) { return q0 + s * (2.0 * q1 + s * q2); };
+		double vertex = q2 > 0.0 ? -q1 / q2 : s0;
+		double lowest = q(std::min(std::max(vertex, s0), s1));
+		double highest = s1 == HUGE_VAL ? (q2 > 0.0 ? HUGE_VAL : q(s0)) : std::max(q(s0), q(s1));
+		return lowest <= outer * outer && (inner <= 0.0 || highest >= inner * inner);
+	}
+
+	// Squared distance from the chord of an arc to the ray along unit u, closest points first
+	// unclamped, then clamped to the segment and to s >= 0 in turn.
+	double _chord_distance(const curves::arc& part, const curves::ray& r, const double* u) noexcept
+	{
+		double d[3], w[3];
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			d[i] = part.q[i] - part.p[i];
+			w[i] = part.p[i] - r.origin[i];
+		}
+		double a = dot(d, d), b = dot(d, u), c = dot(d, w), f = dot(u, w), denominator = a - b * b;
+		double lambda = denominator > 0.0 ? std::min(std::max((b * f - c) / denominator, 0.0), 1.0) : 0.0;
+		double s = b * lambda + f;
+		if (s < 0.0)
+		{
+			s = 0.0;
+			lambda = a > 0.0 ? std::min(std::max(-c / a, 0.0), 1.0) : 0.0;
+		}
+		for (std::size_t i = 0; i < 3; ++i)
+			w[i] += lambda * d[i] - s * u[i];
+		return dot(w, w);
+	}
+
+	// position along the ray; approaches behind the origin all lie at it
+	double _reached(const curves::ray_hit& hit) noexcept
+	{ return std::max(hit.approach.s, 0.0); }
+
+	bool _before(const curves::ray_hit& a, const curves::ray_hit& b) noexcept
+	{
+		double x = _reached(a), y = _reached(b);
+		return x < y || (x == y && (a.approach.distance < b.approach.distance
+			|| (a.approach.distance == b.approach.distance && a.id < b.id)));
+	}
+}
+
+curves::ray_approach curves::ray_distance(const baked_form& k, const ray& r) noexcept
+{
+	if (k.c[0] == 0.0 && k.c[1] == 0.0 && k.c[2] == 0.0)
+	{
+		ray_approach result;
+		_search(k, r, 0.0, two_pi, HUGE_VAL, result);
+		if (result.t == two_pi)
+			result.t = 0.0;
+		return result;
+	}
+	// the window of max_turns around the parameter abreast of the origin
+	double u[3], w[3];
+	_unit(r, u);
+	double cu = dot(k.c, u);
+	for (std::size_t i = 0; i < 3; ++i)
+		w[i] = k.c[i] - cu * u[i];
+	double rate = std::sqrt(dot(w, w));
+	double center = rate > 1e-12 * std::sqrt(dot(k.c, k.c)) ? dot(r.origin, w) / (rate * rate) : dot(r.origin, u) / cu;
+	double width = projector::max_turns * two_pi;
+	ray_approach result;
+	_search(k, r, center - width, center + width, HUGE_VAL, result);
+	return result;
+}
+
+curves::ray_approach curves::ray_distance(const baked_form& k, const ray& r, double t0, double t1) noexcept
+{
+	ray_approach result;
+	_search(k, r, std::min(t0, t1), std::max(t0, t1), HUGE_VAL, result);
+	return result;
+}
+
+curves::ray_approach curves::ray_distance(const interface_curve& curve, const ray& r) noexcept
+{ return ray_distance(curve.get_baked_form(), r); }
+
+curves::ray_approach curves::ray_distance(const interface_curve& curve, const ray& r, double t0, double t1) noexcept
+{ return ray_distance(curve.get_baked_form(), r, t0, t1); }
+
+bool curves::pick(const curve_collection& collection, const arc_tree& arcs, const ray& r, double tolerance,
+	ray_hit& hit)
+{
+	double u[3];
+	_unit(r, u);
+	hit.id = 0;
+	hit.approach.s = HUGE_VAL;
+	hit.approach.distance = HUGE_VAL;
+	arcs.tree().query(r, tolerance, [&](curve_id index)
+	{
+		const arc& part = arcs.arcs()[index];
+		double near = part.reach + tolerance;
+		if (_chord_distance(part, r, u) > near * near)
+			return _reached(hit);
+		curve_collection::slot s = collection.find(part.id);
+		if (s.index == curve_collection::npos)
+			return _reached(hit);
+		const baked_form& k = s.type == CIRCLE ? collection.circles().baked[s.index]
+			: s.type == ELLIPSE ? collection.ellipses().baked[s.index] : collection.helices().baked[s.index];
+		ray_hit current;
+		current.id = part.id;
+		if ((s.type == HELIX || _near_ring(k, r, u, tolerance))
+			&& _search(k, r, part.t0, part.t1, 0.5 * tolerance * tolerance, current.approach)
+			&& current.approach.distance <= tolerance && _before(current, hit))
+			hit = current;
+		return _reached(hit);
+	});
+	return hit.approach.s != HUGE_VAL;
+}
@@ -0,0 +1,47 @@
+#ifndef _CAD_PICKING
+#define _CAD_PICKING
+
+#include "bvh.hpp"
+#include "closest_point.hpp"
+
+namespace curves
+{
+	// Closest approach of a curve to a ray: curve parameter t, ray position s (in units of
+	// direction), the curve point and its distance to the ray.
+	struct ray_approach
+	{
+		double t, s;
+		curve_point point;
+		double distance;
+	};
+
+	struct ray_hit
+	{
+		curve_id id;
+		ray_approach approach;
+	};
+
+	// The distance to the ray is the distance to its line ahead of the origin and to the origin
+	// behind it. The parameter range is sampled in steps of at most pi / 8 and the minima of the
+	// samples are refined by Newton. For a helix whose axis is not along the ray only a window
+	// is sampled: sideways the helix drifts by a fixed rate per unit t, so beyond a width set by
+	// the best distance so far it cannot come closer. Without a range, circles and ellipses cover
+	// one turn and helices projector::max_turns either side of the parameter abreast of the origin.
+	DLL_API ray_approach ray_distance(const baked_form& k, const ray& r) noexcept;
+	DLL_API ray_approach ray_distance(const baked_form& k, const ray& r, double t0, double t1) noexcept;
+	DLL_API ray_approach ray_distance(const interface_curve& curve, const ray& r) noexcept;
+	DLL_API ray_approach ray_distance(const interface_curve& curve, const ray& r, double t0, double t1) noexcept;
+
+	// The arc of the tree within tolerance of the ray whose closest approach comes first along it,
+	// approaches behind the origin counting as at it; ties go to the nearer approach, then to the
+	// lower id. A curve crossing the ray twice is hit where it crosses first.
+	// Arcs come nearest first from the ray query of the tree, and once a hit is known arcs entered
+	// beyond it are not opened. Arcs whose chord stays farther than reach plus tolerance from the
+	// ray are rejected without looking up their curve, and arcs of curves erased since the tree was
+	// built are skipped; circles and ellipses are rejected when the ray passes their plane nowhere
+	// near their ring, the rest are searched only where they can come within tolerance.
+	DLL_API bool pick(const curve_collection& collection, const arc_tree& arcs, const ray& r, double tolerance,
+		ray_hit& hit);
+}
+
+#endif
@@ -0,0 +1,375 @@
+#include "pch.h"
+#include "proximity.hpp"
+#include "bvh.hpp"
+#include "closest_point.hpp"
+#include "reduce.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using curves::numeric::pi;
+	using curves::numeric::two_pi;
+	using curves::numeric::dot;
+
+	const double _step = pi / 8.0;
+	// arcs of the broad phase, and how often chords may be split before the narrow phase
+	const double _arc_step = pi / 16.0;
+	const unsigned _halvings = 6;
+
+	bool _planar(const curves::baked_form& k) noexcept { return k.c[0] == 0.0 && k.c[1] == 0.0 && k.c[2] == 0.0; }
+
+	// P(t), P'(t) and P''(t)
+	void _evaluate(const curves::baked_form& k, double t, double* p, double* d, double* dd) noexcept
+	{
+		double c = std::cos(t), s = std::sin(t);
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			dd[i] = -(k.a[i] * c + k.b[i] * s);
+			p[i] = -dd[i] + k.c[i] * t;
+			d[i] = -k.a[i] * s + k.b[i] * c + k.c[i];
+		}
+	}
+
+	// Parameters s within w of a sample where D(s) = min |P(s) - Q(t)| is distance, reached at t.
+	// D changes by at most |P'| per unit s, so it stays above floor = distance - speed * w.
+	struct _cell
+	{
+		double floor, s, w, t, distance;
+		bool refined;
+
+		// heap order: lowest floor on top
+		bool operator<(const _cell& other) const noexcept { return floor > other.floor; }
+	};
+
+	// P(first + h i) for i = 0, ..., n; circles and ellipses cover at most one turn
+	struct _samples
+	{
+		double first, last, h, speed;
+		std::size_t n;
+		std::vector<double> p;
+		std::vector<_cell> cells;
+
+		void fill(const curves::baked_form& k, double t0, double t1)
+		{
+			first = t0;
+			last = _planar(k) ? std::min(t1, t0 + two_pi) : t1;
+			double range = std::max(last - first, 0.0);
+			n = std::max<std::size_t>(static_cast<std::size_t>(std::ceil(range / _step)), 1);
+			h = range / static_cast<double>(n);
+			speed = std::sqrt(dot(k.a, k.a)) + std::sqrt(dot(k.b, k.b)) + std::sqrt(dot(k.c, k.c));
+			p.resize(3 * (n + 1));
+			double rc = std::cos(h), rs = std::sin(h), c = 0.0, s = 0.0;
+			for (std::size_t i = 0; i <= n; ++i)
+			{
+				double t = first + h * static_cast<double>(i);
+				if (i % 16 == 0)
+				{
+					c = std::cos(t);
+					s = std::sin(t);
+				}
+				for (std::size_t j = 0; j < 3; ++j)
+					p[3 * i + j] = k.a[j] * c + k.b[j] * s + k.c[j] * t;
+				double rotated = c * rc - s * rs;
+				s = s * rc + c * rs;
+				c = rotated;
+			}
+		}
+	};
+
+	// Newton on g(s, t) = |P(s) - Q(t)|^2 / 2 inside [s0, s1] x [t0, t1]; returns 2 g
+	double _refine(const curves::baked_form& kp, const curves::baked_form& kq, double& s, double& t,
+		double s0, double s1, double t0, double t1) noexcept
+	{
+		double p[3], dp[3], ddp[3], q[3], dq[3], ddq[3], w[3];
+		_evaluate(kp, s, p, dp, ddp);
+		_evaluate(kq, t, q, dq, ddq);
+		for (std::size_t i = 0; i < 3; ++i)
+			w[i] = p[i] - q[i];
+		double d2 = dot(w, w);
+		for (std::size_t iteration = 0; iteration < 32; ++iteration)
+		{
+			double gs = dot(w, dp), gt = -dot(w, dq);
+			double pp = dot(dp, dp), qq = dot(dq, dq), pq = -dot(dp, dq);
+			double hss = pp + dot(w, ddp), htt = qq - dot(w, ddq);
+			if (!(hss > 0.0 && hss * htt - pq * pq > 0.0))
+			{
+				hss = pp;
+				htt = qq;
+			}
+			// a ridge keeps the Gauss-Newton matrix invertible where the tangents are parallel
+			double ridge = 1e-10 * (pp + qq);
+			hss += ridge;
+			htt += ridge;
+			double det = hss * htt - pq * pq;
+			if (!(det > 0.0))
+				break;
+			double ds = -(htt * gs - pq * gt) / det, dt = -(hss * gt - pq * gs) / det;
+			// a parameter on a range end that the gradient pushes outwards stays there
+			bool hold_s = (s <= s0 && gs > 0.0) || (s >= s1 && gs < 0.0);
+			bool hold_t = (t <= t0 && gt > 0.0) || (t >= t1 && gt < 0.0);
+			if (hold_s && hold_t)
+				break;
+			if (hold_s)
+			{
+				ds = 0.0;
+				dt = -gt / htt;
+			}
+			else if (hold_t)
+			{
+				dt = 0.0;
+				ds = -gs / hss;
+			}
+			// near the minimum the step is taken as it is, since rounding hides any further decrease
+			bool close = std::abs(ds) + std::abs(dt) <= 1e-9 * (1.0 + std::abs(s) + std::abs(t));
+			double ns = s, nt = t, nd2 = d2, np[3], ndp[3], nddp[3], nq[3], ndq[3], nddq[3], nw[3];
+			for (std::size_t halving = 0; halving < 16; ++halving, ds *= 0.5, dt *= 0.5)
+			{
+				ns = std::clamp(s + ds, s0, s1);
+				nt = std::clamp(t + dt, t0, t1);
+				_evaluate(kp, ns, np, ndp, nddp);
+				_evaluate(kq, nt, nq, ndq, nddq);
+				for (std::size_t j = 0; j < 3; ++j)
+					nw[j] = np[j] - nq[j];
+				nd2 = dot(nw, nw);
+				if (nd2 < d2 || close)
+					break;
+			}
+			if (!(nd2 < d2) && !(close && nd2 <= d2 * (1.0 + 1e-12)))
+				break;
+			s = ns;
+			t = nt;
+			d2 = nd2;
+			std::copy(ndp, ndp + 3, dp);
+			std::copy(nddp, nddp + 3, ddp);
+			std::copy(ndq, ndq + 3, dq);
+			std::copy(nddq, nddq + 3, ddq);
+			std::copy(nw, nw + 3, w);
+			if (close)
+				break;
+		}
+		return d2;
+	}
+
+	// Samples P(s_i) are projected onto Q exactly, and each stands for the cell of half a step
+	// around it. Cells are taken lowest floor first while one can still come within limit and
+	// closer than the best so far by more than a thousandth of it: each is refined from its sample
+	// and projection, then split in three down to a twentieth of the step, so that a closer branch
+	// of Q hidden by a large floor gets samples of its own. s runs over [p0, p1] and t over
+	// [q0, q1]; parameters of circles and ellipses over a whole turn wrap instead of clamping.
+	curves::curve_approach _search(const curves::baked_form& kp, const curves::baked_form& kq,
+		double p0, double p1, double q0, double q1, double limit, _samples& a)
+	{
+		const bool wrap_p = _planar(kp) && p1 - p0 >= two_pi, wrap_q = _planar(kq) && q1 - q0 >= two_pi;
+		const double s0 = wrap_p ? -HUGE_VAL : p0, s1 = wrap_p ? HUGE_VAL : p1;
+		const double u0 = wrap_q ? -HUGE_VAL : q0, u1 = wrap_q ? HUGE_VAL : q1;
+		a.fill(kp, p0, p1);
+		curves::projector project(kq);
+		curves::curve_approach best = { a.first, q0, HUGE_VAL };
+		double best_d2 = HUGE_VAL;
+		a.cells.clear();
+		auto add = [&](double s, double w, const double* p)
+		{
+			curves::closest_point cp = project(p[0], p[1], p[2], q0, q1);
+			if (cp.distance * cp.distance < best_d2)
+			{
+				best_d2 = cp.distance * cp.distance;
+				best.s = s;
+				best.t = cp.t;
+			}
+			a.cells.push_back({ cp.distance - a.speed * w, s, w, cp.t, cp.distance, false });
+			std::push_heap(a.cells.begin(), a.cells.end());
+		};
+		for (std::size_t i = 0; i <= a.n; ++i)
+			add(a.first + a.h * static_cast<double>(i), 0.5 * a.h, &a.p[3 * i]);
+
+		while (!a.cells.empty())
+		{
+			double floor = a.cells.front().floor;
+			if (floor > limit || floor >= 0.999 * std::sqrt(best_d2))
+				break;
+			std::pop_heap(a.cells.begin(), a.cells.end());
+			_cell cell = a.cells.back();
+			a.cells.pop_back();
+			if (!cell.refined)
+			{
+				double s = cell.s, t = cell.t, refined = _refine(kp, kq, s, t, s0, s1, u0, u1);
+				if (refined < best_d2)
+				{
+					best_d2 = refined;
+					best.s = s;
+					best.t = t;
+				}
+			}
+			// the middle third keeps the sample and its refinement
+			double w = cell.w / 3.0, p[3], d[3], dd[3];
+			if (w < 0.05 * a.h)
+				continue;
+			a.cells.push_back({ cell.distance - a.speed * w, cell.s, w, cell.t, cell.distance, true });
+			std::push_heap(a.cells.begin(), a.cells.end());
+			for (double s : { cell.s - 2.0 * w, cell.s + 2.0 * w })
+				if (s >= a.first && s <= a.last)
+				{
+					_evaluate(kp, s, p, d, dd);
+					add(s, w, p);
+				}
+		}
+		if (wrap_p)
+			best.s = p0 + std::fmod(best.s - p0, two_pi) + (best.s < p0 ? two_pi : 0.0);
+		if (wrap_q)
+			best.t = q0 + std::fmod(best.t - q0, two_pi) + (best.t < q0 ? two_pi : 0.0);
+		best.distance = std::sqrt(best_d2);
+		return best;
+	}
+
+	// Samples the helix when only one curve is one, so that projections go onto the ellipse.
+	curves::curve_approach _closest(const curves::baked_form& kp, const curves::baked_form& kq,
+		double p0, double p1, double q0, double q1, double limit, _samples& a)
+	{
+		if (!_planar(kp) || _planar(kq))
+			return _search(kp, kq, p0, p1, q0, q1, limit, a);
+		curves::curve_approach swapped = _search(kq, kp, q0, q1, p0, p1, limit, a);
+		return { swapped.t, swapped.s, swapped.distance };
+	}
+
+	// Squared distance between the segments from p0 to p1 and from q0 to q1, by the closest
+	// points of their lines clamped to the segments in turn.
+	double _segments(const double* p0, const double* p1, const double* q0, const double* q1) noexcept
+	{
+		double d1[3], d2[3], r[3];
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			d1[i] = p1[i] - p0[i];
+			d2[i] = q1[i] - q0[i];
+			r[i] = p0[i] - q0[i];
+		}
+		double a = dot(d1, d1), e = dot(d2, d2), f = dot(d2, r), c = dot(d1, r), b = dot(d1, d2);
+		double s = 0.0, t = 0.0, denominator = a * e - b * b;
+		if (a > 0.0 && e > 0.0)
+		{
+			s = denominator > 0.0 ? std::clamp((b * f - c * e) / denominator, 0.0, 1.0) : 0.0;
+			t = (b * s + f) / e;
+			if (t < 0.0 || t > 1.0)
+			{
+				t = std::clamp(t, 0.0, 1.0);
+				s = std::clamp((b * t - c) / a, 0.0, 1.0);
+			}
+		}
+		else if (a > 0.0)
+			s = std::clamp(-c / a, 0.0, 1.0);
+		else if (e > 0.0)
+			t = std::clamp(f / e, 0.0, 1.0);
+		double w[3];
+		for (std::size_t i = 0; i < 3; ++i)
+			w[i] = r[i] + d1[i] * s - d2[i] * t;
+		return dot(w, w);
+	}
+
+	// Two arcs can only come within tolerance when their chords do within both reaches more.
+	// Otherwise the longer arc is halved, which quarters its reach, and both halves are tried in
+	// turn, at most depth times along the way; false when some pieces may still come close.
+	bool _apart(const curves::baked_form& kx, const curves::arc& x, const curves::baked_form& ky,
+		const curves::arc& y, double tolerance, unsigned depth) noexcept
+	{
+		double reach = x.reach + y.reach + tolerance;
+		if (_segments(x.p, x.q, y.p, y.q) > reach * reach)
+			return true;
+		if (depth == 0)
+			return false;
+		bool first = x.reach >= y.reach;
+		const curves::baked_form& k = first ? kx : ky;
+		const curves::arc& whole = first ? x : y;
+		curves::arc halves[2] = { whole, whole };
+		double t = 0.5 * (whole.t0 + whole.t1), m[3];
+		curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t, m[0], m[1], m[2]);
+		halves[0].t1 = halves[1].t0 = t;
+		halves[0].reach = halves[1].reach = 0.25 * whole.reach;
+		std::copy(m, m + 3, halves[0].q);
+		std::copy(m, m + 3, halves[1].p);
+		for (const curves::arc& half : halves)
+			if (!(first ? _apart(kx, half, ky, y, tolerance, depth - 1) : _apart(kx, x, ky, half, tolerance, depth - 1)))
+				return false;
+		return true;
+	}
+}
+
+curves::curve_approach curves::closest(const baked_form& p, const baked_form& q, double t0, double t1) noexcept
+{
+	_samples a;
+	return _closest(p, q, t0, t1, t0, t1, HUGE_VAL, a);
+}
+
+curves::curve_approach curves::closest(const interface_curve& p, const interface_curve& q, double t0, double t1) noexcept
+{ return closest(p.get_baked_form(), q.get_baked_form(), t0, t1); }
+
+void curves::close_pairs(const curve_collection& collection, double tolerance, double t0, double t1,
+	std::vector<close_pair>& result)
+{
+	if (!(tolerance >= 0.0))
+		throw curve_builder::build_exception("Proximity tolerance is not valid");
+	// arcs in the order of their boxes, so that those a query reaches lie together
+	const arc_tree arcs(collection, t0, t1, _arc_step);
+	const bvh& tree = arcs.tree();
+	std::vector<const baked_form*> forms(arcs.arcs().size());
+	const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(forms.size());
+	#pragma omp parallel for schedule(static)
+	for (std::ptrdiff_t i = 0; i < n; ++i)
+	{
+		curve_collection::slot s = collection.find(arcs.arcs()[i].id);
+		forms[i] = s.type == CIRCLE ? &collection.circles().baked[s.index]
+			: s.type == ELLIPSE ? &collection.ellipses().baked[s.index] : &collection.helices().baked[s.index];
+	}
+
+	std::vector<std::vector<close_pair>> local(static_cast<std::size_t>(reduce::threads()));
+	#pragma omp parallel num_threads(static_cast<int>(local.size()))
+	{
+#ifdef _OPENMP
+		std::vector<close_pair>& found = local[static_cast<std::size_t>(omp_get_thread_num())];
+#else
+		std::vector<close_pair>& found = local[0];
+#endif
+		_samples a;
+		std::vector<curve_id> overlaps;
+		#pragma omp for schedule(dynamic, 256)
+		for (std::ptrdiff_t i = 0; i < n; ++i)
+		{
+			// boxes within tolerance of each other
+			const arc& x = arcs.arcs()[i];
+			aabb box = tree.box(static_cast<std::size_t>(i));
+			for (std::size_t j = 0; j < 3; ++j)
+			{
+				box.min[j] -= tolerance;
+				box.max[j] += tolerance;
+			}
+			overlaps.clear();
+			tree.query(box, overlaps);
+			for (curve_id j : overlaps)
+			{
+				const arc& y = arcs.arcs()[j];
+				if (j <= static_cast<curve_id>(i) || x.id == y.id || _apart(*forms[i], x, *forms[j], y, tolerance, _halvings))
+					continue;
+				curve_approach approach = _closest(*forms[i], *forms[j], x.t0, x.t1, y.t0, y.t1, tolerance, a);
+				if (approach.distance > tolerance)
+					continue;
+				if (x.id < y.id)
+					found.push_back({ x.id, y.id, approach });
+				else
+					found.push_back({ y.id, x.id, { approach.t, approach.s, approach.distance } });
+			}
+		}
+	}
+
+	// arcs of the same two curves may meet several times; the closest meeting stands for them
+	result.clear();
+	for (const std::vector<close_pair>& found : local)
+		result.insert(result.end(), found.begin(), found.end());
+	std::sort(result.begin(), result.end(), [](const close_pair& x, const close_pair& y)
+	{
+		return x.first < y.first || (x.first == y.first && (x.second < y.second
+			|| (x.second == y.second && x.approach.distance < y.approach.distance)));
+	});
+	result.erase(std::unique(result.begin(), result.end(), [](const close_pair& x, const close_pair& y)
+	{ return x.first == y.first && x.second == y.second; }), result.end());
+}
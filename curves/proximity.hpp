@@ -0,0 +1,49 @@
+#ifndef _CAD_PROXIMITY
+#define _CAD_PROXIMITY
+
+#include <vector>
+
+#include "collection.hpp"
+
+namespace curves
+{
+	// Closest approach of two curves: parameter s on the first, t on the second.
+	struct curve_approach
+	{
+		double s, t, distance;
+	};
+
+	struct close_pair
+	{
+		// first < second
+		curve_id first, second;
+		curve_approach approach;
+	};
+
+	// One curve is sampled over [t0, t1] in steps of at most pi / 8 (one turn for circles and
+	// ellipses) and every sample is projected onto the other; a helix is the sampled one when
+	// the other curve is planar. The distance to the other curve changes by at most the speed
+	// bound of the sampled curve per unit parameter, which gives each sample a floor over the
+	// cell around it. Cells whose floor is below the best so far are refined by Newton on both
+	// parameters, from the sample and its projection, and split in three down to a twentieth of
+	// the step, until no cell can beat the best by more than a thousandth of it. Where the Hessian
+	// is not positive definite the Gauss-Newton matrix is used; steps are halved until the
+	// distance drops.
+	DLL_API curve_approach closest(const baked_form& p, const baked_form& q, double t0, double t1) noexcept;
+	DLL_API curve_approach closest(const interface_curve& p, const interface_curve& q, double t0, double t1) noexcept;
+
+	// Pairs of curves that come within tolerance over [t0, t1], ordered by first and second.
+	// Every curve p(t) = a cos t + b sin t + c t passes around the origin, so the boxes of whole
+	// curves are nested and overlap almost all at once. The broad phase therefore works on arcs of
+	// pi / 16: every arc of an arc_tree queries the tree with its box grown by tolerance, in
+	// parallel. Each pair of arcs found is kept only while their chords come within tolerance
+	// plus both reaches, halving the longer arc up to six times to tighten the reach. The
+	// remaining pairs go to the narrow phase over the parameters of the two arcs, which stops
+	// refining once no sample can come within tolerance; the closest of them stands for the two
+	// curves. The work still grows with the square of the density: arcs crowded into the same
+	// region, such as many curves of similar size around the origin, meet most of each other.
+	DLL_API void close_pairs(const curve_collection& collection, double tolerance, double t0, double t1,
+		std::vector<close_pair>& result);
+}
+
+#endif
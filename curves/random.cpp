@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "random.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+
+namespace
+{
+	using curves::numeric::two_pi;
+
+	void _mulhilo(std::uint32_t a, std::uint32_t b, std::uint32_t& hi, std::uint32_t& lo) noexcept
+	{
+		std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+		hi = static_cast<std::uint32_t>(product >> 32);
+		lo = static_cast<std::uint32_t>(product);
+	}
+
+	double _unit(std::uint32_t hi, std::uint32_t lo) noexcept
+	{
+		std::uint64_t bits = (static_cast<std::uint64_t>(hi) << 32 | lo) >> 11;
+		return static_cast<double>(bits) * (1.0 / 9007199254740992.0);
+	}
+
+	double _lerp(const curves::uniform_range& range, double u) noexcept
+	{ return range.min + (range.max - range.min) * u; }
+
+	bool _valid(const curves::uniform_range& range) noexcept
+	{ return range.min >= 0.0 && range.max >= range.min && std::isfinite(range.max); }
+
+	curves::curve_t _pick(const curves::random_options& options, double u) noexcept
+	{
+		double x = u * (options.mix[0] + options.mix[1] + options.mix[2]);
+		if (x < options.mix[0])
+			return curves::CIRCLE;
+		if (x < options.mix[0] + options.mix[1] || options.mix[2] == 0.0)
+			return curves::ELLIPSE;
+		return curves::HELIX;
+	}
+
+	// Shoemake's uniform unit quaternion from three uniforms, expanded to a rotation matrix
+	mv::mat3 _rotation(double u1, double u2, double u3) noexcept
+	{
+		double r1 = std::sqrt(1.0 - u1), r2 = std::sqrt(u1);
+		double x = r1 * std::sin(two_pi * u2), y = r1 * std::cos(two_pi * u2);
+		double z = r2 * std::sin(two_pi * u3), w = r2 * std::cos(two_pi * u3);
+		mv::mat3 result;
+		result[0][0] = 1.0 - 2.0 * (y * y + z * z);
+		result[0][1] = 2.0 * (x * y - z * w);
+		result[0][2] = 2.0 * (x * z + y * w);
+		result[1][0] = 2.0 * (x * y + z * w);
+		result[1][1] = 1.0 - 2.0 * (x * x + z * z);
+		result[1][2] = 2.0 * (y * z - x * w);
+		result[2][0] = 2.0 * (x * z - y * w);
+		result[2][1] = 2.0 * (y * z + x * w);
+		result[2][2] = 1.0 - 2.0 * (x * x + y * y);
+		return result;
+	}
+}
+
+void curves::philox::generate(std::uint64_t index, std::uint32_t draw, std::uint32_t out[4]) const noexcept
+{
+	std::uint32_t c[4] = { static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32), draw, 0 };
+	std::uint32_t k[2] = { _key[0], _key[1] };
+	for (int round = 0; round < 10; ++round)
+	{
+		std::uint32_t hi0, lo0, hi1, lo1;
+		_mulhilo(0xD2511F53u, c[0], hi0, lo0);
+		_mulhilo(0xCD9E8D57u, c[2], hi1, lo1);
+		c[0] = hi1 ^ c[1] ^ k[0];
+		c[1] = lo1;
+		c[2] = hi0 ^ c[3] ^ k[1];
+		c[3] = lo0;
+		k[0] += 0x9E3779B9u;
+		k[1] += 0xBB67AE85u;
+	}
+	for (int i = 0; i < 4; ++i)
+		out[i] = c[i];
+}
+
+void curves::philox::uniform(std::uint64_t index, std::uint32_t draw, double& u0, double& u1) const noexcept
+{
+	std::uint32_t bits[4];
+	generate(index, draw, bits);
+	u0 = _unit(bits[0], bits[1]);
+	u1 = _unit(bits[2], bits[3]);
+}
+
+void curves::validate(const random_options& options)
+{
+	double total = options.mix[0] + options.mix[1] + options.mix[2];
+	if (!(options.mix[0] >= 0.0 && options.mix[1] >= 0.0 && options.mix[2] >= 0.0 && total > 0.0))
+		throw curve_builder::build_exception("Curve type weights are not valid");
+	if (!_valid(options.radius) || !_valid(options.step))
+		throw curve_builder::build_exception("Curve is not physically correct");
+	if (!(options.operator_probability >= 0.0 && options.operator_probability <= 1.0))
+		throw curve_builder::build_exception("Operator probability is not valid");
+}
+
+curves::curve_t curves::draw_type(const philox& generator, std::uint64_t index,
+	const random_options& options) noexcept
+{
+	double u, unused;
+	generator.uniform(index, 0, u, unused);
+	return _pick(options, u);
+}
+
+curves::random_curve curves::draw_curve(const philox& generator, std::uint64_t index,
+	const random_options& options) noexcept
+{
+	random_curve result;
+	double kind, with_operator, u0, u1;
+	generator.uniform(index, 0, kind, with_operator);
+	result.type = _pick(options, kind);
+	generator.uniform(index, 1, u0, u1);
+	result.p0 = _lerp(options.radius, u0);
+	result.p1 = result.type == HELIX ? _lerp(options.step, u1)
+		: result.type == ELLIPSE ? _lerp(options.radius, u1) : 0.0;
+	if (with_operator >= options.operator_probability)
+		return result;
+	double u[10];
+	switch (options.operator_type)
+	{
+	case DIAGONAL:
+		generator.uniform(index, 2, u[0], u[1]);
+		generator.uniform(index, 3, u[2], u[3]);
+		for (std::size_t i = 0; i < 3; ++i)
+			result.lin_op[i][i] = _lerp(options.operator_entry, u[i]);
+		break;
+	case ORTHOGONAL:
+		generator.uniform(index, 2, u[0], u[1]);
+		generator.uniform(index, 3, u[2], u[3]);
+		result.lin_op = _rotation(u[0], u[1], u[2]);
+		break;
+	case GENERAL:
+		for (std::uint32_t j = 0; j < 5; ++j)
+			generator.uniform(index, 2 + j, u[2 * j], u[2 * j + 1]);
+		for (std::size_t i = 0; i < 9; ++i)
+			result.lin_op[i / 3][i % 3] = _lerp(options.operator_entry, u[i]);
+		break;
+	default:
+		break;
+	}
+	return result;
+}
+
+curves::curve_builder::curve_ptr curves::make_random_curve(std::uint64_t seed, std::uint64_t index,
+	const random_options& options)
+{
+	validate(options);
+	random_curve curve = draw_curve(philox(seed), index, options);
+	switch (curve.type)
+	{
+	case ELLIPSE:
+		return curve_builder::make_curve<ELLIPSE>(curve.p0, curve.p1, curve.lin_op);
+	case HELIX:
+		return curve_builder::make_curve<HELIX>(curve.p0, curve.p1, curve.lin_op);
+	default:
+		return curve_builder::make_curve<CIRCLE>(curve.p0, curve.lin_op);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef _CAD_RANDOM
+#define _CAD_RANDOM
+
+#include <cstdint>
+
+#include "curves.hpp"
+
+namespace curves
+{
+	// Philox4x32-10 (Salmon et al., SC'11): a keyed bijection of 128-bit counters. Draw j of
+	// item i depends only on (seed, i, j), so items can be generated in any order on any thread.
+	class philox final
+	{
+		std::uint32_t _key[2];
+	public:
+		explicit philox(std::uint64_t seed) noexcept
+			: _key{ static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) } {}
+
+		DLL_API void generate(std::uint64_t index, std::uint32_t draw, std::uint32_t out[4]) const noexcept;
+		// two doubles uniform on [0, 1) with 53 random bits each
+		DLL_API void uniform(std::uint64_t index, std::uint32_t draw, double& u0, double& u1) const noexcept;
+	};
+
+	struct uniform_range
+	{
+		double min, max;
+	};
+
+	struct random_options
+	{
+		// relative weights of CIRCLE, ELLIPSE and HELIX
+		double mix[3] = { 1.0, 1.0, 1.0 };
+		// circle and helix radius, both ellipse semi-axes
+		uniform_range radius = { 1.0, 50.0 };
+		uniform_range step = { 1.0, 50.0 };
+
+		// Chance that a curve gets a random linear operator instead of the identity.
+		// DIAGONAL draws a scale per axis, ORTHOGONAL a uniform rotation and GENERAL every entry,
+		// all from operator_entry except rotations.
+		double operator_probability = 0.0;
+		operator_t operator_type = GENERAL;
+		uniform_range operator_entry = { -1.0, 1.0 };
+	};
+
+	struct random_curve
+	{
+		curve_t type;
+		double p0, p1;
+		mv::mat3 lin_op;
+	};
+
+	// Throws curve_builder::build_exception when options cannot produce valid curves.
+	DLL_API void validate(const random_options& options);
+
+	DLL_API curve_t draw_type(const philox& generator, std::uint64_t index, const random_options& options) noexcept;
+	DLL_API random_curve draw_curve(const philox& generator, std::uint64_t index, const random_options& options) noexcept;
+
+	// Curve number index of the population generated from seed, identical to the one
+	// curve_collection::add_random produces at the same position.
+	DLL_API curve_builder::curve_ptr make_random_curve(std::uint64_t seed, std::uint64_t index,
+		const random_options& options = random_options());
+}
+
+#endif
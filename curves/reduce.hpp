@@ -0,0 +1,168 @@
+#ifndef _CAD_REDUCE
+#define _CAD_REDUCE
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace curves
+{
+	namespace reduce
+	{
+		// FAST lets the grouping of additions follow the thread count. DETERMINISTIC sums fixed
+		// blocks with compensation and joins them along a fixed tree: the same input gives the
+		// same bits on any number of threads.
+		enum mode_t { FAST = 0, DETERMINISTIC = 1 };
+
+		constexpr std::size_t block = 1024;
+
+		struct statistics
+		{
+			double sum = 0.0;
+			double min = std::numeric_limits<double>::infinity();
+			double max = -std::numeric_limits<double>::infinity();
+			std::size_t count = 0;
+
+			void add(double value) noexcept
+			{
+				sum += value;
+				min = (std::min)(min, value);
+				max = (std::max)(max, value);
+				++count;
+			}
+		};
+
+		inline statistics combine(const statistics& a, const statistics& b) noexcept
+		{
+			statistics result;
+			result.sum = a.sum + b.sum;
+			result.min = (std::min)(a.min, b.min);
+			result.max = (std::max)(a.max, b.max);
+			result.count = a.count + b.count;
+			return result;
+		}
+
+		inline int threads() noexcept
+		{
+#ifdef _OPENMP
+			return omp_get_max_threads();
+#else
+			return 1;
+#endif
+		}
+
+		// Every thread folds one contiguous chunk of [0, count) into its own partial with
+		// accumulate(partial, i); the partials are then combined pairwise as a binary tree.
+		// Without OpenMP the same code runs as a single chunk.
+		template <typename _partial, typename _accumulate, typename _combine>
+		_partial run(std::size_t count, const _partial& identity,
+			const _accumulate& accumulate, const _combine& combine)
+		{
+			std::vector<_partial> partials(static_cast<std::size_t>(threads()), identity);
+			const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(count);
+			#pragma omp parallel num_threads(static_cast<int>(partials.size()))
+			{
+#ifdef _OPENMP
+				std::size_t thread = static_cast<std::size_t>(omp_get_thread_num());
+#else
+				std::size_t thread = 0;
+#endif
+				_partial local = identity;
+				#pragma omp for schedule(static) nowait
+				for (std::ptrdiff_t i = 0; i < n; ++i)
+					accumulate(local, static_cast<std::size_t>(i));
+				partials[thread] = local;
+			}
+			for (std::size_t stride = 1; stride < partials.size(); stride *= 2)
+			{
+				for (std::size_t i = 0; i + stride < partials.size(); i += 2 * stride)
+					partials[i] = combine(partials[i], partials[i + stride]);
+			}
+			return partials[0];
+		}
+
+		// [0, count) is cut into blocks of a fixed size that do not depend on the thread count;
+		// each block is folded in order, then the block partials are joined pairwise by index.
+		template <typename _partial, typename _accumulate, typename _combine>
+		_partial run_blocked(std::size_t count, const _partial& identity,
+			const _accumulate& accumulate, const _combine& combine)
+		{
+			std::vector<_partial> partials((count + block - 1) / block, identity);
+			const std::ptrdiff_t blocks = static_cast<std::ptrdiff_t>(partials.size());
+			#pragma omp parallel for schedule(static)
+			for (std::ptrdiff_t b = 0; b < blocks; ++b)
+			{
+				std::size_t first = static_cast<std::size_t>(b) * block;
+				std::size_t last = (std::min)(first + block, count);
+				for (std::size_t i = first; i < last; ++i)
+					accumulate(partials[b], i);
+			}
+			if (partials.empty())
+				return identity;
+			for (std::size_t stride = 1; stride < partials.size(); stride *= 2)
+			{
+				for (std::size_t i = 0; i + stride < partials.size(); i += 2 * stride)
+					partials[i] = combine(partials[i], partials[i + stride]);
+			}
+			return partials[0];
+		}
+
+		// Neumaier summation: sum + correction carries the rounding error of every addition.
+		struct compensated
+		{
+			statistics value;
+			double correction = 0.0;
+
+			void add(double v) noexcept
+			{
+				double sum = value.sum + v;
+				if (std::abs(value.sum) >= std::abs(v))
+					correction += (value.sum - sum) + v;
+				else
+					correction += (v - sum) + value.sum;
+				value.sum = sum;
+				value.min = (std::min)(value.min, v);
+				value.max = (std::max)(value.max, v);
+				++value.count;
+			}
+		};
+
+		inline compensated combine(const compensated& a, const compensated& b) noexcept
+		{
+			compensated result;
+			result.value = combine(a.value, b.value);
+			double sum = result.value.sum;
+			double rest = std::abs(a.value.sum) >= std::abs(b.value.sum)
+				? (a.value.sum - sum) + b.value.sum : (b.value.sum - sum) + a.value.sum;
+			result.correction = a.correction + b.correction + rest;
+			return result;
+		}
+
+		template <typename _value_of>
+		statistics run(std::size_t count, const _value_of& value_of, mode_t mode = FAST)
+		{
+			if (mode == DETERMINISTIC)
+			{
+				compensated result = run_blocked(count, compensated(),
+					[&value_of](compensated& partial, std::size_t i) { partial.add(value_of(i)); },
+					[](const compensated& a, const compensated& b) { return reduce::combine(a, b); });
+				result.value.sum += result.correction;
+				return result.value;
+			}
+			return run(count, statistics(),
+				[&value_of](statistics& partial, std::size_t i) { partial.add(value_of(i)); },
+				[](const statistics& a, const statistics& b) { return reduce::combine(a, b); });
+		}
+
+		inline statistics run(const double* values, std::size_t count, mode_t mode = FAST)
+		{ return run(count, [values](std::size_t i) { return values[i]; }, mode); }
+	}
+}
+
+#endif
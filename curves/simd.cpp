@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "simd_kernels.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define _CAD_CPUID
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define _CAD_CPUID
+#endif
+
+namespace
+{
+	using curves::simd::detail::kernels;
+
+	constexpr kernels _scalar = _entries<_scalar_pack>::table("scalar");
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	constexpr kernels _sse2 = _entries<_sse2_pack>::table("sse2");
+#endif
+
+#if defined(_CAD_CPUID)
+	// registers eax, ebx, ecx, edx of cpuid leaf, subleaf
+	void _cpuid(unsigned leaf, unsigned subleaf, unsigned* r) noexcept
+	{
+#if defined(_MSC_VER)
+		int out[4];
+		__cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+		for (std::size_t i = 0; i < 4; ++i)
+			r[i] = static_cast<unsigned>(out[i]);
+#else
+		if (!__get_cpuid_count(leaf, subleaf, r, r + 1, r + 2, r + 3))
+			r[0] = r[1] = r[2] = r[3] = 0;
+#endif
+	}
+
+	// register state the operating system saves on context switches
+	unsigned long long _xcr0() noexcept
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned lo, hi;
+		__asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+	}
+
+	// AVX2 needs AVX, FMA and the YMM state enabled; AVX-512F the opmask and ZMM state as well.
+	void _features(bool& avx2, bool& avx512) noexcept
+	{
+		unsigned r[4];
+		avx2 = avx512 = false;
+		_cpuid(0, 0, r);
+		if (r[0] < 7)
+			return;
+		_cpuid(1, 0, r);
+		const unsigned osxsave = 1u << 27, avx = 1u << 28, fma = 1u << 12;
+		if ((r[2] & (osxsave | avx | fma)) != (osxsave | avx | fma))
+			return;
+		unsigned long long xcr0 = _xcr0();
+		_cpuid(7, 0, r);
+		avx2 = (xcr0 & 0x6) == 0x6 && (r[1] & (1u << 5)) != 0;
+		avx512 = avx2 && (xcr0 & 0xe6) == 0xe6 && (r[1] & (1u << 16)) != 0;
+	}
+#endif
+
+	// the kernels built into the library that the processor runs, widest first
+	std::size_t _candidates(const kernels** result) noexcept
+	{
+		std::size_t n = 0;
+#if defined(_CAD_CPUID)
+		bool avx2, avx512;
+		_features(avx2, avx512);
+		if (avx512 && curves::simd::detail::avx512_kernels() != nullptr)
+			result[n++] = curves::simd::detail::avx512_kernels();
+		if (avx2 && curves::simd::detail::avx2_kernels() != nullptr)
+			result[n++] = curves::simd::detail::avx2_kernels();
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		result[n++] = &_sse2;
+#endif
+		result[n++] = &_scalar;
+		return n;
+	}
+
+	std::atomic<const kernels*>& _selected() noexcept
+	{
+		static std::atomic<const kernels*> selected([]
+		{
+			const kernels* candidates[4];
+			_candidates(candidates);
+			return candidates[0];
+		}());
+		return selected;
+	}
+
+	const kernels& _current() noexcept
+	{ return *_selected().load(std::memory_order_relaxed); }
+}
+
+const char* curves::simd::instruction_set() noexcept { return _current().name; }
+
+bool curves::simd::use_instruction_set(const char* name) noexcept
+{
+	const kernels* candidates[4];
+	std::size_t n = _candidates(candidates);
+	for (std::size_t i = 0; i < n; ++i)
+		if (std::strcmp(candidates[i]->name, name) == 0)
+		{
+			_selected().store(candidates[i], std::memory_order_relaxed);
+			return true;
+		}
+	return false;
+}
+
+void curves::simd::sincos(const double* t, std::size_t count, double* s, double* c) noexcept
+{ _current().sincos(t, count, s, c); }
+
+void curves::simd::get_values(const baked_form& k, const double* t, std::size_t count,
+	double* x, double* y, double* z) noexcept
+{ _current().get_values(k, t, count, x, y, z); }
+
+void curves::simd::get_d_dt_values(const baked_form& k, const double* t, std::size_t count,
+	double* x, double* y, double* z) noexcept
+{ _current().get_d_dt_values(k, t, count, x, y, z); }
+
+void curves::simd::get_value_and_derivative(const baked_form& k, const double* t, std::size_t count,
+	double* x, double* y, double* z, double* dx, double* dy, double* dz) noexcept
+{ _current().get_value_and_derivative(k, t, count, x, y, z, dx, dy, dz); }
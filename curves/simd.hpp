@@ -0,0 +1,32 @@
+#ifndef _CAD_SIMD
+#define _CAD_SIMD
+
+#include "curves.hpp"
+
+namespace curves
+{
+	namespace simd
+	{
+		// Kernels evaluate a baked_form many parameters at a time and agree with the scalar
+		// path (std::cos, std::sin) within tolerance * (|a| + |b| + |c * t|) per component for |t| <= 1e6.
+		// Packs holding a larger or non-finite parameter are evaluated by the scalar path.
+		constexpr double tolerance = 1e-14;
+
+		// "avx512", "avx2", "sse2" or "scalar": on first use the widest the processor runs, by cpuid.
+		DLL_API const char* instruction_set() noexcept;
+		// Switches every kernel to the named set, for tests and benchmarks; false, leaving the
+		// current one, when the name is unknown or the processor does not run it.
+		DLL_API bool use_instruction_set(const char* name) noexcept;
+
+		DLL_API void sincos(const double* t, std::size_t count, double* s, double* c) noexcept;
+
+		DLL_API void get_values(const baked_form& k, const double* t, std::size_t count,
+			double* x, double* y, double* z) noexcept;
+		DLL_API void get_d_dt_values(const baked_form& k, const double* t, std::size_t count,
+			double* x, double* y, double* z) noexcept;
+		DLL_API void get_value_and_derivative(const baked_form& k, const double* t, std::size_t count,
+			double* x, double* y, double* z, double* dx, double* dy, double* dz) noexcept;
+	}
+}
+
+#endif
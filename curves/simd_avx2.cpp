@@ -0,0 +1,14 @@
+// Built with /arch:AVX2 (-mavx2 -mfma) and without the precompiled header, whose options differ.
+// Reached only after simd.cpp has found AVX2 and FMA on the processor.
+#include "simd_kernels.hpp"
+
+#if defined(__AVX2__)
+namespace
+{
+	constexpr curves::simd::detail::kernels _avx2 = _entries<_avx2_pack>::table("avx2");
+}
+
+const curves::simd::detail::kernels* curves::simd::detail::avx2_kernels() noexcept { return &_avx2; }
+#else
+const curves::simd::detail::kernels* curves::simd::detail::avx2_kernels() noexcept { return nullptr; }
+#endif
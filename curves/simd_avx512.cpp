@@ -0,0 +1,14 @@
+// Built with /arch:AVX512 (-mavx512f) and without the precompiled header, whose options differ.
+// Reached only after simd.cpp has found AVX-512F on the processor.
+#include "simd_kernels.hpp"
+
+#if defined(__AVX512F__)
+namespace
+{
+	constexpr curves::simd::detail::kernels _avx512 = _entries<_avx512_pack>::table("avx512");
+}
+
+const curves::simd::detail::kernels* curves::simd::detail::avx512_kernels() noexcept { return &_avx512; }
+#else
+const curves::simd::detail::kernels* curves::simd::detail::avx512_kernels() noexcept { return nullptr; }
+#endif
@@ -0,0 +1,304 @@
+#ifndef _CAD_SIMD_KERNELS
+#define _CAD_SIMD_KERNELS
+
+// Kernels behind simd.hpp, included by one translation unit per instruction set. Each unit is
+// compiled with its own architecture flags and sees only the packs those flags enable.
+
+#include <cmath>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+#include "simd.hpp"
+
+namespace curves
+{
+	namespace simd
+	{
+		namespace detail
+		{
+			struct kernels
+			{
+				const char* name;
+				void (*sincos)(const double* t, std::size_t count, double* s, double* c) noexcept;
+				void (*get_values)(const baked_form& k, const double* t, std::size_t count,
+					double* x, double* y, double* z) noexcept;
+				void (*get_d_dt_values)(const baked_form& k, const double* t, std::size_t count,
+					double* x, double* y, double* z) noexcept;
+				void (*get_value_and_derivative)(const baked_form& k, const double* t, std::size_t count,
+					double* x, double* y, double* z, double* dx, double* dy, double* dz) noexcept;
+			};
+
+			// nullptr when the unit was built without the flags for its instruction set
+			const kernels* avx2_kernels() noexcept;
+			const kernels* avx512_kernels() noexcept;
+		}
+	}
+}
+
+namespace
+{
+	struct _scalar_pack
+	{
+		using type = double;
+		using mask = bool;
+		static constexpr std::size_t width = 1;
+
+		static type load(const double* p) noexcept { return *p; }
+		static void store(double* p, type v) noexcept { *p = v; }
+		static type set(double v) noexcept { return v; }
+		static type add(type a, type b) noexcept { return a + b; }
+		static type sub(type a, type b) noexcept { return a - b; }
+		static type mul(type a, type b) noexcept { return a * b; }
+		static type fma(type a, type b, type c) noexcept { return a * b + c; }
+		static type round(type x) noexcept { return std::nearbyint(x); }
+		static mask neq(type a, type b) noexcept { return a != b; }
+		static type select(mask m, type a, type b) noexcept { return m ? a : b; }
+		static type negate_if(mask m, type a) noexcept { return m ? -a : a; }
+	};
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	struct _sse2_pack
+	{
+		using type = __m128d;
+		using mask = __m128d;
+		static constexpr std::size_t width = 2;
+
+		static type load(const double* p) noexcept { return _mm_loadu_pd(p); }
+		static void store(double* p, type v) noexcept { _mm_storeu_pd(p, v); }
+		static type set(double v) noexcept { return _mm_set1_pd(v); }
+		static type add(type a, type b) noexcept { return _mm_add_pd(a, b); }
+		static type sub(type a, type b) noexcept { return _mm_sub_pd(a, b); }
+		static type mul(type a, type b) noexcept { return _mm_mul_pd(a, b); }
+		static type fma(type a, type b, type c) noexcept { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+
+		// exact for |x| < 2^51; arguments past _range never reach the packs
+		static type round(type x) noexcept
+		{
+			const type magic = _mm_set1_pd(6755399441055744.0);
+			return _mm_sub_pd(_mm_add_pd(x, magic), magic);
+		}
+
+		static mask neq(type a, type b) noexcept { return _mm_cmpneq_pd(a, b); }
+		static type select(mask m, type a, type b) noexcept
+		{ return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+		static type negate_if(mask m, type a) noexcept
+		{ return _mm_xor_pd(a, _mm_and_pd(m, _mm_set1_pd(-0.0))); }
+	};
+#endif
+
+#if defined(__AVX2__)
+	struct _avx2_pack
+	{
+		using type = __m256d;
+		using mask = __m256d;
+		static constexpr std::size_t width = 4;
+
+		static type load(const double* p) noexcept { return _mm256_loadu_pd(p); }
+		static void store(double* p, type v) noexcept { _mm256_storeu_pd(p, v); }
+		static type set(double v) noexcept { return _mm256_set1_pd(v); }
+		static type add(type a, type b) noexcept { return _mm256_add_pd(a, b); }
+		static type sub(type a, type b) noexcept { return _mm256_sub_pd(a, b); }
+		static type mul(type a, type b) noexcept { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__) || defined(_MSC_VER)
+		static type fma(type a, type b, type c) noexcept { return _mm256_fmadd_pd(a, b, c); }
+#else
+		static type fma(type a, type b, type c) noexcept { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+		static type round(type x) noexcept
+		{ return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static mask neq(type a, type b) noexcept { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+		static type select(mask m, type a, type b) noexcept { return _mm256_blendv_pd(b, a, m); }
+		static type negate_if(mask m, type a) noexcept
+		{ return _mm256_xor_pd(a, _mm256_and_pd(m, _mm256_set1_pd(-0.0))); }
+	};
+#endif
+
+#if defined(__AVX512F__)
+	struct _avx512_pack
+	{
+		using type = __m512d;
+		using mask = __mmask8;
+		static constexpr std::size_t width = 8;
+
+		static type load(const double* p) noexcept { return _mm512_loadu_pd(p); }
+		static void store(double* p, type v) noexcept { _mm512_storeu_pd(p, v); }
+		static type set(double v) noexcept { return _mm512_set1_pd(v); }
+		static type add(type a, type b) noexcept { return _mm512_add_pd(a, b); }
+		static type sub(type a, type b) noexcept { return _mm512_sub_pd(a, b); }
+		static type mul(type a, type b) noexcept { return _mm512_mul_pd(a, b); }
+		static type fma(type a, type b, type c) noexcept { return _mm512_fmadd_pd(a, b, c); }
+		static type round(type x) noexcept
+		{ return _mm512_roundscale_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static mask neq(type a, type b) noexcept { return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ); }
+		static type select(mask m, type a, type b) noexcept { return _mm512_mask_blend_pd(m, b, a); }
+		static type negate_if(mask m, type a) noexcept
+		{ return _mm512_mask_sub_pd(a, m, _mm512_setzero_pd(), a); }
+	};
+#endif
+
+	// Beyond this the three-part reduction by pi/2 loses the tolerance.
+	constexpr double _range = 1e6;
+
+	// true when any of t[0..n) is out of range or NaN
+	inline bool _wide(const double* t, std::size_t n) noexcept
+	{
+		for (std::size_t j = 0; j < n; ++j)
+			if (!(std::abs(t[j]) <= _range))
+				return true;
+		return false;
+	}
+
+	// Cody-Waite reduction by pi/2 followed by the Cephes minimax polynomials on [-pi/4, pi/4].
+	template <typename _p>
+	void _sincos(typename _p::type x, typename _p::type& s, typename _p::type& c) noexcept
+	{
+		using v = typename _p::type;
+		const v one = _p::set(1.0), half = _p::set(0.5);
+
+		v q = _p::round(_p::mul(x, _p::set(0.63661977236758134308)));
+		v r = _p::fma(q, _p::set(-1.57079625129699707031e+0), x);
+		r = _p::fma(q, _p::set(-7.54978941586159635335e-8), r);
+		r = _p::fma(q, _p::set(-5.39030285815811905290e-15), r);
+		v z = _p::mul(r, r);
+
+		v ps = _p::set(1.58962301576546568060e-10);
+		ps = _p::fma(ps, z, _p::set(-2.50507477628578072866e-8));
+		ps = _p::fma(ps, z, _p::set(2.75573136213857245213e-6));
+		ps = _p::fma(ps, z, _p::set(-1.98412698295895385996e-4));
+		ps = _p::fma(ps, z, _p::set(8.33333333332211858878e-3));
+		ps = _p::fma(ps, z, _p::set(-1.66666666666666307295e-1));
+		v sin_r = _p::fma(_p::mul(r, z), ps, r);
+
+		v pc = _p::set(-1.13585365213876817300e-11);
+		pc = _p::fma(pc, z, _p::set(2.08757008419747316778e-9));
+		pc = _p::fma(pc, z, _p::set(-2.75573141792967388112e-7));
+		pc = _p::fma(pc, z, _p::set(2.48015872888517045348e-5));
+		pc = _p::fma(pc, z, _p::set(-1.38888888888730564116e-3));
+		pc = _p::fma(pc, z, _p::set(4.16666666666665929218e-2));
+		v cos_r = _p::fma(_p::mul(z, z), pc, _p::fma(_p::set(-0.5), z, one));
+
+		// quadrant k = q mod 4: odd k swaps sin and cos, k in {2, 3} negates sin, k in {1, 2} negates cos
+		v h = _p::mul(q, half);
+		auto odd = _p::neq(_p::round(h), h);
+		v q_half = _p::select(odd, _p::sub(h, half), h);
+		v q_quarter = _p::mul(q_half, half);
+		auto flip_sin = _p::neq(_p::round(q_quarter), q_quarter);
+		v p_half = _p::select(odd, _p::add(h, half), h);
+		v p_quarter = _p::mul(p_half, half);
+		auto flip_cos = _p::neq(_p::round(p_quarter), p_quarter);
+
+		s = _p::negate_if(flip_sin, _p::select(odd, cos_r, sin_r));
+		c = _p::negate_if(flip_cos, _p::select(odd, sin_r, cos_r));
+	}
+
+	template <typename _p, bool _value, bool _derivative>
+	void _kernel(const curves::baked_form& k, const double* t, std::size_t i,
+		double* const* out) noexcept
+	{
+		using v = typename _p::type;
+		v u = _p::load(t + i), s, c;
+		_sincos<_p>(u, s, c);
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			v a = _p::set(k.a[j]), b = _p::set(k.b[j]), h = _p::set(k.c[j]);
+			if constexpr (_value)
+				_p::store(out[j] + i, _p::fma(a, c, _p::fma(b, s, _p::mul(h, u))));
+			if constexpr (_derivative)
+				_p::store(out[3 + j] + i, _p::fma(b, c, _p::fma(_p::set(-k.a[j]), s, h)));
+		}
+	}
+
+	// the scalar path, for parameters out of range
+	template <bool _value, bool _derivative>
+	void _exact(const curves::baked_form& k, const double* t, std::size_t i,
+		double* const* out) noexcept
+	{
+		double c = std::cos(t[i]), s = std::sin(t[i]);
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			if constexpr (_value)
+				out[j][i] = k.a[j] * c + k.b[j] * s + k.c[j] * t[i];
+			if constexpr (_derivative)
+				out[3 + j][i] = k.b[j] * c - k.a[j] * s + k.c[j];
+		}
+	}
+
+	template <typename _p, bool _value, bool _derivative>
+	void _run(const curves::baked_form& k, const double* t, std::size_t count,
+		double* const* out) noexcept
+	{
+		std::size_t i = 0;
+		for (; i + _p::width <= count; i += _p::width)
+			if (!_wide(t + i, _p::width))
+				_kernel<_p, _value, _derivative>(k, t, i, out);
+			else
+				for (std::size_t j = i; j < i + _p::width; ++j)
+					_exact<_value, _derivative>(k, t, j, out);
+		for (; i < count; ++i)
+			if (!_wide(t + i, 1))
+				_kernel<_scalar_pack, _value, _derivative>(k, t, i, out);
+			else
+				_exact<_value, _derivative>(k, t, i, out);
+	}
+
+	// the entry points of simd.hpp over packs of _p
+	template <typename _p>
+	struct _entries
+	{
+		static void sincos(const double* t, std::size_t count, double* s, double* c) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + _p::width <= count; i += _p::width)
+				if (!_wide(t + i, _p::width))
+				{
+					typename _p::type vs, vc;
+					_sincos<_p>(_p::load(t + i), vs, vc);
+					_p::store(s + i, vs);
+					_p::store(c + i, vc);
+				}
+				else
+					for (std::size_t j = i; j < i + _p::width; ++j)
+					{
+						s[j] = std::sin(t[j]);
+						c[j] = std::cos(t[j]);
+					}
+			for (; i < count; ++i)
+				if (!_wide(t + i, 1))
+					_sincos<_scalar_pack>(t[i], s[i], c[i]);
+				else
+				{
+					s[i] = std::sin(t[i]);
+					c[i] = std::cos(t[i]);
+				}
+		}
+
+		static void get_values(const curves::baked_form& k, const double* t, std::size_t count,
+			double* x, double* y, double* z) noexcept
+		{
+			double* const out[6] = { x, y, z, nullptr, nullptr, nullptr };
+			_run<_p, true, false>(k, t, count, out);
+		}
+
+		static void get_d_dt_values(const curves::baked_form& k, const double* t, std::size_t count,
+			double* x, double* y, double* z) noexcept
+		{
+			double* const out[6] = { nullptr, nullptr, nullptr, x, y, z };
+			_run<_p, false, true>(k, t, count, out);
+		}
+
+		static void get_value_and_derivative(const curves::baked_form& k, const double* t, std::size_t count,
+			double* x, double* y, double* z, double* dx, double* dy, double* dz) noexcept
+		{
+			double* const out[6] = { x, y, z, dx, dy, dz };
+			_run<_p, true, true>(k, t, count, out);
+		}
+
+		static constexpr curves::simd::detail::kernels table(const char* name) noexcept
+		{ return { name, &sincos, &get_values, &get_d_dt_values, &get_value_and_derivative }; }
+	};
+}
+
+#endif
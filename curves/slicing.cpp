@@ -0,0 +1,246 @@
+#include "pch.h"
+#include "slicing.hpp"
+#include "reduce.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using curves::numeric::pi;
+	using curves::numeric::two_pi;
+	using curves::numeric::dot;
+
+	struct _root
+	{
+		double t, c, s;
+	};
+
+	// f(t) = n.P(t) = A cos t + B sin t + C t = R cos(t - phi) + C t
+	struct _profile
+	{
+		double A, B, C, R, phi;
+
+		_profile(const curves::baked_form& k, const double* n) noexcept
+			: A(dot(k.a, n)), B(dot(k.b, n)), C(dot(k.c, n)), R(std::hypot(A, B)), phi(std::atan2(B, A)) {}
+
+		double operator()(double t) const noexcept { return A * std::cos(t) + B * std::sin(t) + C * t; }
+
+		// the t in [u, v] with f(t) = d, f monotone on [u, v] and d between f(u) and f(v); Newton
+		// starts from guess, clamped into [u, v]
+		_root solve(double d, double u, double v, double fu, double fv, double guess) const noexcept
+		{
+			_root r;
+			if (C == 0.0)
+			{
+				// [u, v] lies within one half turn phi + j pi, where f falls for even j and rises for odd j
+				double x = std::clamp(d / R, -1.0, 1.0), y = std::sqrt(1.0 - x * x);
+				double j = std::floor((0.5 * (u + v) - phi) / pi);
+				bool falling = std::fmod(j, 2.0) == 0.0;
+				double theta = falling ? j * pi + std::acos(x) : (j + 1.0) * pi - std::acos(x);
+				r.t = std::clamp(phi + theta, u, v);
+				// cos and sin of t from those of phi and theta
+				double cp = A / R, sp = B / R, st = falling ? y : -y;
+				r.c = cp * x - sp * st;
+				r.s = sp * x + cp * st;
+				return r;
+			}
+			// f - d turned to rise through the root
+			bool rising = fv > fu;
+			double c, s, step, t = curves::numeric::newton([this, d, rising, &c, &s](double x, double& slope)
+			{
+				c = std::cos(x);
+				s = std::sin(x);
+				double g = A * c + B * s + C * x - d;
+				slope = rising ? B * c - A * s + C : A * s - B * c - C;
+				return rising ? g : -g;
+			}, std::clamp(guess, u, v), u, v, step);
+			// the step left is below 1e-8, so rotating cos and sin through it to first order is exact
+			r.t = t + step;
+			r.c = c - s * step;
+			r.s = s + c * step;
+			return r;
+		}
+
+		// start for the next plane of a piece from the root of the previous one
+		double extrapolate(const _root& r, double d, double next) const noexcept
+		{
+			double slope = B * r.c - A * r.s + C;
+			return slope != 0.0 ? r.t + (next - d) / slope : r.t;
+		}
+
+		static double chord(double d, double u, double v, double fu, double fv) noexcept
+		{ return u + (v - u) * (d - fu) / (fv - fu); }
+	};
+
+	// Calls piece(u, v, f(u), f(v), first) for the monotone pieces of f over [t0, t1] in order.
+	// Maxima sit at phi + beta and minima at phi + pi - beta per turn, beta = asin(C / R).
+	template <typename _piece>
+	void _pieces(const _profile& f, double t0, double t1, const _piece& piece)
+	{
+		if (!(t1 >= t0))
+			return;
+		double u = t0, fu = f(t0);
+		bool first = true;
+		if (std::abs(f.C) < f.R)
+		{
+			double beta = std::asin(f.C / f.R), start = f.phi + beta, gap = pi - 2.0 * beta;
+			for (double k = std::floor((t0 - start) / two_pi); start + k * two_pi < t1; k += 1.0)
+			{
+				const double critical[2] = { start + k * two_pi, start + k * two_pi + gap };
+				for (double v : critical)
+					if (v > u && v < t1)
+					{
+						double fv = f(v);
+						piece(u, v, fu, fv, first);
+						u = v;
+						fu = fv;
+						first = false;
+					}
+			}
+		}
+		piece(u, t1, fu, f(t1), first);
+	}
+
+	// Planes [lo, hi) crossed by a piece. Its crossings lie in (u, v], or in [u, v] for the first
+	// piece, so a plane touching a turning point is counted once.
+	void _span(const double* d, std::size_t layers, double fu, double fv, bool first,
+		std::size_t& lo, std::size_t& hi) noexcept
+	{
+		const double* end = d + layers;
+		lo = hi = 0;
+		if (fv > fu)
+		{
+			lo = (first ? std::lower_bound(d, end, fu) : std::upper_bound(d, end, fu)) - d;
+			hi = std::upper_bound(d, end, fv) - d;
+		}
+		else if (fv < fu)
+		{
+			lo = std::lower_bound(d, end, fv) - d;
+			hi = (first ? std::upper_bound(d, end, fu) : std::lower_bound(d, end, fu)) - d;
+		}
+	}
+
+	struct _source
+	{
+		curves::operator_t type;
+		const curves::baked_form* k;
+		curves::curve_id id;
+	};
+
+	// Curves are split into fixed chunks: the counting pass gives every chunk its own starting
+	// row per plane, and the writing pass fills exactly those rows.
+	void _slice(const std::vector<_source>& sources, const double* normal, const double* offsets,
+		std::size_t layers, double t0, double t1, curves::sections& result)
+	{
+		if (!std::is_sorted(offsets, offsets + layers))
+			throw curves::curve_builder::build_exception("Plane offsets are not ascending");
+		const std::size_t chunks = std::min<std::size_t>(sources.size(),
+			16 * static_cast<std::size_t>(curves::reduce::threads())), stride = layers + 1;
+		const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(chunks);
+		std::vector<std::size_t> cursor(chunks * stride, 0);
+		auto begin = [&sources, chunks](std::ptrdiff_t c) { return sources.size() * static_cast<std::size_t>(c) / chunks; };
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (std::ptrdiff_t c = 0; c < n; ++c)
+		{
+			// differences: a piece adds one row to each plane in [lo, hi)
+			std::size_t* count = cursor.data() + c * stride;
+			for (std::size_t i = begin(c); i < begin(c + 1); ++i)
+				_pieces(_profile(*sources[i].k, normal), t0, t1,
+					[count, offsets, layers](double, double, double fu, double fv, bool first)
+				{
+					std::size_t lo, hi;
+					_span(offsets, layers, fu, fv, first, lo, hi);
+					++count[lo];
+					--count[hi];
+				});
+			for (std::size_t j = 1; j < layers; ++j)
+				count[j] += count[j - 1];
+		}
+
+		result.offsets.assign(layers + 1, 0);
+		std::size_t rows = 0;
+		for (std::size_t j = 0; j < layers; ++j)
+		{
+			for (std::size_t c = 0; c < chunks; ++c)
+			{
+				std::size_t count = cursor[c * stride + j];
+				cursor[c * stride + j] = rows;
+				rows += count;
+			}
+			result.offsets[j + 1] = rows;
+		}
+		result.id.resize(rows);
+		result.t.resize(rows);
+		result.points.resize(rows);
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (std::ptrdiff_t c = 0; c < n; ++c)
+		{
+			std::size_t* next = cursor.data() + c * stride;
+			for (std::size_t i = begin(c); i < begin(c + 1); ++i)
+			{
+				const _source& source = sources[i];
+				_profile f(*source.k, normal);
+				_pieces(f, t0, t1, [&](double u, double v, double fu, double fv, bool first)
+				{
+					std::size_t lo, hi;
+					_span(offsets, layers, fu, fv, first, lo, hi);
+					double guess = lo < hi ? _profile::chord(offsets[lo], u, v, fu, fv) : 0.0;
+					for (std::size_t j = lo; j < hi; ++j)
+					{
+						_root r = f.solve(offsets[j], u, v, fu, fv, guess);
+						if (j + 1 < hi)
+							guess = f.extrapolate(r, offsets[j], offsets[j + 1]);
+						std::size_t row = next[j]++;
+						result.id[row] = source.id;
+						result.t[row] = r.t;
+						curves::curve_point& p = result.points[row];
+						curves::combine(source.type, *source.k, r.c, r.s, r.t, p[0], p[1], p[2]);
+					}
+				});
+			}
+		}
+	}
+}
+
+void curves::intersect(const baked_form& k, const plane& p, double t0, double t1, std::vector<double>& t)
+{
+	t.clear();
+	_profile f(k, p.normal);
+	_pieces(f, t0, t1, [&f, &p, &t](double u, double v, double fu, double fv, bool first)
+	{
+		std::size_t lo, hi;
+		_span(&p.offset, 1, fu, fv, first, lo, hi);
+		if (lo < hi)
+			t.push_back(f.solve(p.offset, u, v, fu, fv, _profile::chord(p.offset, u, v, fu, fv)).t);
+	});
+}
+
+void curves::intersect(const interface_curve& curve, const plane& p, double t0, double t1, std::vector<double>& t)
+{ intersect(curve.get_baked_form(), p, t0, t1, t); }
+
+void curves::slice(const curve_builder::curve_ptr* curves, std::size_t count, const double* normal,
+	const double* offsets, std::size_t layers, double t0, double t1, sections& result)
+{
+	std::vector<_source> sources(count);
+	for (std::size_t i = 0; i < count; ++i)
+		sources[i] = { curves[i]->get_operator_type(), &curves[i]->get_baked_form(), i };
+	_slice(sources, normal, offsets, layers, t0, t1, result);
+}
+
+void curves::slice(const curve_collection& collection, const double* normal,
+	const double* offsets, std::size_t layers, double t0, double t1, sections& result)
+{
+	std::vector<_source> sources;
+	sources.reserve(collection.size());
+	for (std::size_t i = 0; i < collection.circles().id.size(); ++i)
+		sources.push_back({ collection.circles().op_type[i], &collection.circles().baked[i], collection.circles().id[i] });
+	for (std::size_t i = 0; i < collection.ellipses().id.size(); ++i)
+		sources.push_back({ collection.ellipses().op_type[i], &collection.ellipses().baked[i], collection.ellipses().id[i] });
+	for (std::size_t i = 0; i < collection.helices().id.size(); ++i)
+		sources.push_back({ collection.helices().op_type[i], &collection.helices().baked[i], collection.helices().id[i] });
+	_slice(sources, normal, offsets, layers, t0, t1, result);
+}
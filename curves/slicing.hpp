@@ -0,0 +1,48 @@
+#ifndef _CAD_SLICING
+#define _CAD_SLICING
+
+#include <vector>
+
+#include "collection.hpp"
+
+namespace curves
+{
+	// Points p with normal.p = offset; the normal need not be of unit length.
+	struct plane
+	{
+		double normal[3], offset;
+	};
+
+	// Intersections of many curves with a stack of parallel planes: plane j occupies rows
+	// offsets[j] to offsets[j + 1], ordered by curve and then by t. id holds the collection id,
+	// or the array index for curve arrays.
+	struct sections
+	{
+		std::vector<std::size_t> offsets;
+		std::vector<curve_id> id;
+		std::vector<double> t;
+		std::vector<curve_point> points;
+	};
+
+	// Along the normal a curve is f(t) = R cos(t - phi) + C t with R, phi and C from the baked
+	// form. f is monotone between the zeros of f' = C - R sin(t - phi), which sit at phi + beta
+	// and phi + pi - beta per turn with beta = asin(C / R), so every plane crosses each such piece
+	// at most once. With C = 0 (circles, ellipses, helices whose axis lies in the plane) the
+	// root is acos in closed form, otherwise bracketed Newton inside the piece. Tangent contacts
+	// count once; a curve lying in the plane has no isolated roots and contributes nothing.
+	// The result is overwritten with the parameters in [t0, t1], ascending.
+	DLL_API void intersect(const baked_form& k, const plane& p, double t0, double t1, std::vector<double>& t);
+	DLL_API void intersect(const interface_curve& curve, const plane& p, double t0, double t1, std::vector<double>& t);
+
+	// Slices every curve over [t0, t1] with the planes normal.p = offsets[j], which must be
+	// ascending. The pieces of a curve are walked once and each finds the planes it spans by
+	// binary search. A counting pass sizes the result, so the buffers are resized once per call
+	// and the second pass writes every row into place; both run in parallel over curve chunks.
+	DLL_API void slice(const curve_builder::curve_ptr* curves, std::size_t count, const double* normal,
+		const double* offsets, std::size_t layers, double t0, double t1, sections& result);
+	// Curves follow the bucket order of the collection.
+	DLL_API void slice(const curve_collection& collection, const double* normal,
+		const double* offsets, std::size_t layers, double t0, double t1, sections& result);
+}
+
+#endif
@@ -0,0 +1,376 @@
+#include "pch.h"
+#include "storage.hpp"
+
+#include <cmath>
+#include <array>
+#include <unordered_map>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	using _matrix = std::array<double, 9>;
+
+	bool _little_endian() noexcept
+	{
+		const std::uint16_t probe = 1;
+		return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+	}
+
+	// operators are deduplicated by their exact bit patterns
+	struct _bits_hash
+	{
+		std::size_t operator()(const _matrix& m) const noexcept
+		{
+			std::uint64_t h = 14695981039346656037ull, word;
+			for (double v : m)
+			{
+				std::memcpy(&word, &v, sizeof(word));
+				h = (h ^ word) * 1099511628211ull;
+				h ^= h >> 29;
+			}
+			return static_cast<std::size_t>(h);
+		}
+	};
+
+	struct _bits_equal
+	{
+		bool operator()(const _matrix& a, const _matrix& b) const noexcept
+		{ return std::memcmp(a.data(), b.data(), sizeof(_matrix)) == 0; }
+	};
+
+	using _table = std::unordered_map<_matrix, std::uint32_t, _bits_hash, _bits_equal>;
+
+	std::uint64_t _align(std::uint64_t offset) noexcept { return (offset + 7) & ~std::uint64_t(7); }
+
+	std::uint32_t _intern(_table& table, const mv::mat3& m)
+	{
+		_matrix key;
+		std::copy(m.cbegin(), m.cend(), key.begin());
+		auto found = table.emplace(key, static_cast<std::uint32_t>(table.size()));
+		return found.first->second;
+	}
+
+	template <typename _bucket, typename _parameters>
+	std::vector<curves::storage::record> _records(const _bucket& b,
+		_table& table, const _parameters& parameters)
+	{
+		std::vector<curves::storage::record> result(b.id.size());
+		for (std::size_t i = 0; i < b.id.size(); ++i)
+		{
+			curves::storage::record& r = result[i];
+			r.baked = b.baked[i];
+			parameters(i, r.p0, r.p1);
+			r.id = b.id[i];
+			r.op = _intern(table, b.lin_op[i]);
+			r.op_type = static_cast<std::uint32_t>(b.op_type[i]);
+		}
+		return result;
+	}
+
+	template <bool _derivative>
+	void _evaluate(const curves::storage::record* records, std::size_t count, const double* t,
+		double* x, double* y, double* z) noexcept
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const curves::storage::record& r = records[i];
+			double c = std::cos(t[i]), s = std::sin(t[i]);
+			curves::operator_t type = static_cast<curves::operator_t>(r.op_type);
+			if constexpr (_derivative)
+				curves::combine(type, r.baked, -s, c, 1.0, x[i], y[i], z[i]);
+			else
+				curves::combine(type, r.baked, c, s, t[i], x[i], y[i], z[i]);
+		}
+	}
+
+	template <bool _derivative>
+	void _evaluate_at(const curves::storage::record* records, std::size_t count, double t,
+		double* x, double* y, double* z) noexcept
+	{
+		double c = std::cos(t), s = std::sin(t);
+		double wa = _derivative ? -s : c, wb = _derivative ? c : s, wc = _derivative ? 1.0 : t;
+		for (std::size_t i = 0; i < count; ++i)
+			curves::combine(static_cast<curves::operator_t>(records[i].op_type), records[i].baked,
+				wa, wb, wc, x[i], y[i], z[i]);
+	}
+
+	// what curve_collection accepts for a radius, semi-axis or step
+	bool _physical(double value) noexcept { return value >= 0.0 && std::isfinite(value); }
+}
+
+void curves::save(const curve_collection& collection, const char* path)
+{
+	if (!_little_endian())
+		throw storage_exception("Storage format requires a little-endian host");
+
+	_table table;
+	table.reserve(collection.size() / 4 + 1);
+	std::vector<storage::record> sections[3] = {
+		_records(collection.circles(), table,
+			[&](std::size_t i, double& p0, double& p1) { p0 = collection.circles().R[i]; p1 = 0.0; }),
+		_records(collection.ellipses(), table,
+			[&](std::size_t i, double& p0, double& p1) { p0 = collection.ellipses().Rx[i]; p1 = collection.ellipses().Ry[i]; }),
+		_records(collection.helices(), table,
+			[&](std::size_t i, double& p0, double& p1) { p0 = collection.helices().R[i]; p1 = collection.helices().h[i]; })
+	};
+	std::vector<_matrix> operators(table.size());
+	for (const auto& entry : table)
+		operators[entry.second] = entry.first;
+
+	storage::file_header header = {};
+	std::memcpy(header.magic, storage::magic, sizeof(header.magic));
+	header.version = storage::version;
+	header.record_size = sizeof(storage::record);
+	header.next_id = collection.next_id();
+	header.operator_count = operators.size();
+	header.operator_offset = _align(sizeof(header));
+	std::uint64_t offset = header.operator_offset + operators.size() * sizeof(_matrix);
+	for (std::size_t type = 0; type < 3; ++type)
+	{
+		offset = _align(offset);
+		header.count[type] = sections[type].size();
+		header.offset[type] = offset;
+		offset += sections[type].size() * sizeof(storage::record);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		throw storage_exception("Cannot open file for writing");
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(operators.data()),
+		static_cast<std::streamsize>(operators.size() * sizeof(_matrix)));
+	for (const auto& section : sections)
+		file.write(reinterpret_cast<const char*>(section.data()),
+			static_cast<std::streamsize>(section.size() * sizeof(storage::record)));
+	if (!file)
+		throw storage_exception("Cannot write file");
+}
+
+curves::mapped_collection::mapped_collection(const char* path)
+{
+	if (!_little_endian())
+		throw storage_exception("Storage format requires a little-endian host");
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw storage_exception("Cannot open file");
+	_file = file;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		_close();
+		throw storage_exception("Cannot read file size");
+	}
+	_size = static_cast<std::size_t>(size.QuadPart);
+	if (_size != 0)
+	{
+		_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping != nullptr)
+			_view = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (_view == nullptr)
+		{
+			_close();
+			throw storage_exception("Cannot map file");
+		}
+	}
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		throw storage_exception("Cannot open file");
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		throw storage_exception("Cannot read file size");
+	}
+	_size = static_cast<std::size_t>(status.st_size);
+	if (_size != 0)
+	{
+		void* view = mmap(nullptr, _size, PROT_READ, MAP_SHARED, file, 0);
+		if (view != MAP_FAILED)
+			_view = static_cast<const unsigned char*>(view);
+	}
+	close(file);
+	if (_size != 0 && _view == nullptr)
+		throw storage_exception("Cannot map file");
+#endif
+
+	const char* error = nullptr;
+	if (_size < sizeof(storage::file_header))
+		error = "File is too small";
+	else if (std::memcmp(_header().magic, storage::magic, sizeof(storage::magic)) != 0)
+		error = "File is not a curve collection";
+	else if (_header().version != storage::version || _header().record_size != sizeof(storage::record))
+		error = "Unsupported file version";
+	else
+	{
+		const storage::file_header& h = _header();
+		auto fits = [this](std::uint64_t offset, std::uint64_t count, std::uint64_t size)
+		{ return offset % 8 == 0 && offset <= _size && count <= (_size - offset) / size; };
+		if (!fits(h.operator_offset, h.operator_count, sizeof(_matrix)))
+			error = "Operator table is out of bounds";
+		for (std::size_t type = 0; type < 3 && error == nullptr; ++type)
+			if (!fits(h.offset[type], h.count[type], sizeof(storage::record)))
+				error = "Curve section is out of bounds";
+	}
+	if (error != nullptr)
+	{
+		_close();
+		throw storage_exception(error);
+	}
+}
+
+curves::mapped_collection::~mapped_collection() { _close(); }
+
+curves::mapped_collection::mapped_collection(mapped_collection&& other) noexcept
+	: _view(other._view), _size(other._size), _file(other._file), _mapping(other._mapping)
+{
+	other._view = nullptr;
+	other._size = 0;
+	other._file = nullptr;
+	other._mapping = nullptr;
+}
+
+curves::mapped_collection& curves::mapped_collection::operator=(mapped_collection&& other) noexcept
+{
+	if (this != &other)
+	{
+		_close();
+		std::swap(_view, other._view);
+		std::swap(_size, other._size);
+		std::swap(_file, other._file);
+		std::swap(_mapping, other._mapping);
+	}
+	return *this;
+}
+
+void curves::mapped_collection::_close() noexcept
+{
+#ifdef _WIN32
+	if (_view != nullptr)
+		UnmapViewOfFile(_view);
+	if (_mapping != nullptr)
+		CloseHandle(_mapping);
+	if (_file != nullptr)
+		CloseHandle(_file);
+#else
+	if (_view != nullptr)
+		munmap(const_cast<unsigned char*>(_view), _size);
+#endif
+	_view = nullptr;
+	_size = 0;
+	_file = nullptr;
+	_mapping = nullptr;
+}
+
+mv::mat3 curves::mapped_collection::get_linear_operator(std::size_t op) const
+{
+	if (op >= operator_count())
+		throw storage_exception("Operator index is out of bounds");
+	const double* entries = reinterpret_cast<const double*>(_view + _header().operator_offset) + 9 * op;
+	mv::mat3 result;
+	std::copy(entries, entries + 9, result.begin());
+	return result;
+}
+
+curves::curve_builder::curve_ptr curves::mapped_collection::make_curve(curve_t type, std::size_t index) const
+{
+	if (index >= size(type))
+		throw storage_exception("Record index is out of bounds");
+	const storage::record& r = records(type)[index];
+	mv::mat3 linear_operator = get_linear_operator(r.op);
+	switch (type)
+	{
+	case ELLIPSE:
+		return curve_builder::make_curve<ELLIPSE>(r.p0, r.p1, linear_operator);
+	case HELIX:
+		return curve_builder::make_curve<HELIX>(r.p0, r.p1, linear_operator);
+	default:
+		return curve_builder::make_curve<CIRCLE>(r.p0, linear_operator);
+	}
+}
+
+curves::curve_collection curves::mapped_collection::load() const
+{
+	const storage::file_header& h = _header();
+	// erased identifiers take no room in the file, so any next_id from the record count up to
+	// what the slot table can hold is valid
+	const std::uint64_t stored = h.count[CIRCLE] + h.count[ELLIPSE] + h.count[HELIX];
+	curve_collection result;
+	if (h.next_id < stored || h.next_id > static_cast<std::uint64_t>(result._slots.max_size()))
+		throw storage_exception("Next curve identifier is not valid");
+	result._slots.assign(static_cast<std::size_t>(h.next_id), { CIRCLE, curve_collection::npos });
+	for (curve_t type : { CIRCLE, ELLIPSE, HELIX })
+	{
+		result.reserve(type, size(type));
+		const storage::record* r = records(type);
+		for (std::size_t i = 0; i < size(type); ++i)
+		{
+			if (r[i].id >= h.next_id)
+				throw storage_exception("Curve identifier is out of bounds");
+			if (r[i].op_type > GENERAL)
+				throw storage_exception("Unknown operator type");
+			if (!_physical(r[i].p0) || (type != CIRCLE && !_physical(r[i].p1)))
+				throw storage_exception("Curve is not physically correct");
+			mv::mat3 linear_operator = get_linear_operator(r[i].op);
+			operator_t op_type = static_cast<operator_t>(r[i].op_type);
+			curve_id id = static_cast<curve_id>(r[i].id);
+			if (result._slots[id].index != curve_collection::npos)
+				throw storage_exception("Duplicate curve identifier");
+			result._slots[id] = { type, i };
+			switch (type)
+			{
+			case CIRCLE:
+				result._circles.R.push_back(r[i].p0);
+				result._circles.lin_op.push_back(linear_operator);
+				result._circles.op_type.push_back(op_type);
+				result._circles.baked.push_back(r[i].baked);
+				result._circles.id.push_back(id);
+				result._radii.insert(r[i].p0, id);
+				break;
+			case ELLIPSE:
+				result._ellipses.Rx.push_back(r[i].p0);
+				result._ellipses.Ry.push_back(r[i].p1);
+				result._ellipses.lin_op.push_back(linear_operator);
+				result._ellipses.op_type.push_back(op_type);
+				result._ellipses.baked.push_back(r[i].baked);
+				result._ellipses.id.push_back(id);
+				break;
+			case HELIX:
+				result._helices.R.push_back(r[i].p0);
+				result._helices.h.push_back(r[i].p1);
+				result._helices.lin_op.push_back(linear_operator);
+				result._helices.op_type.push_back(op_type);
+				result._helices.baked.push_back(r[i].baked);
+				result._helices.id.push_back(id);
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+void curves::mapped_collection::get_values(curve_t type, const double* t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate<false>(records(type), size(type), t, x, y, z); }
+
+void curves::mapped_collection::get_d_dt_values(curve_t type, const double* t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate<true>(records(type), size(type), t, x, y, z); }
+
+void curves::mapped_collection::get_values_at(curve_t type, double t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<false>(records(type), size(type), t, x, y, z); }
+
+void curves::mapped_collection::get_d_dt_values_at(curve_t type, double t,
+	double* x, double* y, double* z) const noexcept
+{ _evaluate_at<true>(records(type), size(type), t, x, y, z); }
@@ -0,0 +1,96 @@
+#ifndef _CAD_STORAGE
+#define _CAD_STORAGE
+
+#include <cstdint>
+
+#include "collection.hpp"
+#include "exceptions.hpp"
+
+namespace curves
+{
+	// Little-endian container, every section aligned to 8 bytes:
+	//   file_header
+	//   operator table: operator_count matrices of 9 doubles, row-major
+	//   circle, ellipse and helix sections: count[type] records each
+	// A record carries the baked form next to its parameters, so mapped
+	// records are evaluated in place without rebuilding anything.
+	namespace storage
+	{
+		constexpr char magic[8] = { 'C', 'A', 'D', 'C', 'U', 'R', 'V', 'S' };
+		constexpr std::uint32_t version = 1;
+
+		struct file_header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t record_size;
+			std::uint64_t next_id;
+			std::uint64_t operator_count;
+			std::uint64_t operator_offset;
+			std::uint64_t count[3];
+			std::uint64_t offset[3];
+		};
+
+		struct record
+		{
+			baked_form baked;
+			// R for circles, Rx and Ry for ellipses, R and h for helices
+			double p0, p1;
+			std::uint64_t id;
+			std::uint32_t op;
+			std::uint32_t op_type;
+		};
+
+		static_assert(sizeof(file_header) == 88, "unexpected header layout");
+		static_assert(sizeof(record) == 104, "unexpected record layout");
+	}
+
+	// Curves saved with identical linear operators share one entry of the operator table.
+	DLL_API void save(const curve_collection& collection, const char* path);
+
+	// Read-only view of a saved collection. Opening validates the header and section bounds
+	// only; records are read straight from the mapped pages on demand.
+	class mapped_collection final
+	{
+		const unsigned char* _view = nullptr;
+		std::size_t _size = 0;
+		void* _file = nullptr;
+		void* _mapping = nullptr;
+
+		const storage::file_header& _header() const noexcept
+		{ return *reinterpret_cast<const storage::file_header*>(_view); }
+		void _close() noexcept;
+	public:
+		DLL_API explicit mapped_collection(const char* path);
+		DLL_API ~mapped_collection();
+
+		mapped_collection(const mapped_collection&) = delete;
+		mapped_collection& operator=(const mapped_collection&) = delete;
+		DLL_API mapped_collection(mapped_collection&& other) noexcept;
+		DLL_API mapped_collection& operator=(mapped_collection&& other) noexcept;
+
+		std::size_t size(curve_t type) const noexcept { return static_cast<std::size_t>(_header().count[type]); }
+		std::size_t size() const noexcept { return size(CIRCLE) + size(ELLIPSE) + size(HELIX); }
+		std::size_t operator_count() const noexcept { return static_cast<std::size_t>(_header().operator_count); }
+
+		const storage::record* records(curve_t type) const noexcept
+		{ return reinterpret_cast<const storage::record*>(_view + _header().offset[type]); }
+
+		DLL_API mv::mat3 get_linear_operator(std::size_t op) const;
+		DLL_API curve_builder::curve_ptr make_curve(curve_t type, std::size_t index) const;
+
+		// Rebuilds an editable collection with the saved identifiers, erased ones included:
+		// its next insertion gets the same id the saved collection would have given. Throws
+		// storage_exception on duplicate or out-of-range identifiers, unknown operator types,
+		// negative or non-finite radii and steps, and a next identifier below the record count.
+		DLL_API curve_collection load() const;
+
+		// Same contracts as the curve_collection forms, over the mapped records of one type.
+		DLL_API void get_values(curve_t type, const double* t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values(curve_t type, const double* t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_values_at(curve_t type, double t, double* x, double* y, double* z) const noexcept;
+		DLL_API void get_d_dt_values_at(curve_t type, double t, double* x, double* y, double* z) const noexcept;
+	};
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "tessellate.hpp"
+#include "reduce.hpp"
+#include "numeric.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+	using curves::numeric::dot;
+	using curves::numeric::cross;
+
+	struct _node
+	{
+		double t, c, s;
+		double p[3], d[3];
+	};
+
+	// Longest initial step. Zero curvature bounds nothing, yet a curve flattened by a singular
+	// operator still turns back on itself; a quarter turn keeps its reversals apart.
+	constexpr double _max_step = curves::numeric::pi / 2.0;
+
+	class _tessellator
+	{
+		curves::operator_t _type;
+		const curves::baked_form& _k;
+		const curves::tessellation_options& _options;
+	public:
+		_tessellator(curves::operator_t type, const curves::baked_form& k,
+			const curves::tessellation_options& options) noexcept
+			: _type(type), _k(k), _options(options) {}
+
+		_node node(double t) const noexcept
+		{
+			_node n;
+			n.t = t;
+			n.c = std::cos(t);
+			n.s = std::sin(t);
+			curves::combine(_type, _k, n.c, n.s, t, n.p[0], n.p[1], n.p[2]);
+			curves::combine(_type, _k, -n.s, n.c, 1.0, n.d[0], n.d[1], n.d[2]);
+			return n;
+		}
+
+		// Parameter step allowed by the curvature at n: P'' = -(a cos t + b sin t).
+		double step(const _node& n) const noexcept
+		{
+			double dd[3], normal[3];
+			curves::combine(_type, _k, -n.c, -n.s, 0.0, dd[0], dd[1], dd[2]);
+			cross(n.d, dd, normal);
+			double speed = std::sqrt(dot(n.d, n.d));
+			if (speed == 0.0)
+				return _max_step;
+			double kappa = std::sqrt(dot(normal, normal)) / (speed * speed * speed);
+			if (kappa == 0.0)
+				return _max_step;
+			double length = std::min(std::sqrt(8.0 * _options.chord / kappa), _options.angle / kappa);
+			return std::min(length / speed, _max_step);
+		}
+
+		bool flat(const _node& a, const _node& m, const _node& b) const noexcept
+		{
+			double chord[3] = { b.p[0] - a.p[0], b.p[1] - a.p[1], b.p[2] - a.p[2] };
+			double offset[3] = { m.p[0] - a.p[0], m.p[1] - a.p[1], m.p[2] - a.p[2] };
+			// distance from the segment, not its line, so a midpoint past either end fails
+			double length2 = dot(chord, chord), along = dot(offset, chord), deviation2;
+			if (length2 > 0.0 && along >= 0.0 && along <= length2)
+			{
+				double normal[3];
+				cross(offset, chord, normal);
+				deviation2 = dot(normal, normal) / length2;
+			}
+			else if (along > 0.0)
+			{
+				double rest[3] = { m.p[0] - b.p[0], m.p[1] - b.p[1], m.p[2] - b.p[2] };
+				deviation2 = dot(rest, rest);
+			}
+			else
+				deviation2 = dot(offset, offset);
+			if (deviation2 > _options.chord * _options.chord)
+				return false;
+			double turn[3];
+			cross(a.d, b.d, turn);
+			return std::atan2(std::sqrt(dot(turn, turn)), dot(a.d, b.d)) <= _options.angle;
+		}
+
+		// Calls emit(node) for every vertex after the first, in order.
+		template <typename _emit>
+		void split(const _node& a, const _node& b, unsigned depth, const _emit& emit) const
+		{
+			_node m = node(0.5 * (a.t + b.t));
+			if (depth < _options.max_depth && !flat(a, m, b))
+			{
+				split(a, m, depth + 1, emit);
+				split(m, b, depth + 1, emit);
+			}
+			else
+				emit(b);
+		}
+
+		template <typename _emit>
+		void run(double t0, double t1, const _emit& emit) const
+		{
+			_node a = node(t0);
+			emit(a);
+			while (a.t < t1)
+			{
+				double t = a.t + step(a);
+				_node b = node(t > a.t && t < t1 ? t : t1);
+				split(a, b, 0, emit);
+				a = b;
+			}
+		}
+	};
+
+	void _check(const curves::tessellation_options& options)
+	{
+		if (!(options.chord > 0.0) || !(options.angle > 0.0))
+			throw curves::curve_builder::build_exception("Tessellation tolerance is not valid");
+	}
+
+	struct _source
+	{
+		curves::operator_t type;
+		const curves::baked_form* k;
+	};
+
+	// Each thread tessellates into its own polyline once; rows are then copied into place.
+	void _tessellate(const std::vector<_source>& sources, double t0, double t1,
+		const curves::tessellation_options& options, curves::polylines& result)
+	{
+		_check(options);
+		const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(sources.size());
+		std::vector<curves::polyline> local(static_cast<std::size_t>(curves::reduce::threads()));
+		std::vector<std::size_t> owner(sources.size()), start(sources.size());
+		result.offsets.assign(sources.size() + 1, 0);
+		#pragma omp parallel num_threads(static_cast<int>(local.size()))
+		{
+#ifdef _OPENMP
+			std::size_t thread = static_cast<std::size_t>(omp_get_thread_num());
+#else
+			std::size_t thread = 0;
+#endif
+			curves::polyline& buffer = local[thread];
+			#pragma omp for schedule(dynamic, 64)
+			for (std::ptrdiff_t i = 0; i < n; ++i)
+			{
+				owner[i] = thread;
+				start[i] = buffer.t.size();
+				_tessellator(sources[i].type, *sources[i].k, options).run(t0, t1, [&buffer](const _node& v)
+				{
+					buffer.t.push_back(v.t);
+					buffer.points.push_back(curves::curve_point(v.p[0], v.p[1], v.p[2]));
+				});
+				result.offsets[i + 1] = buffer.t.size() - start[i];
+			}
+		}
+		for (std::size_t i = 0; i < sources.size(); ++i)
+			result.offsets[i + 1] += result.offsets[i];
+		result.t.resize(result.offsets.back());
+		result.points.resize(result.offsets.back());
+		#pragma omp parallel for schedule(static)
+		for (std::ptrdiff_t i = 0; i < n; ++i)
+		{
+			const curves::polyline& buffer = local[owner[i]];
+			std::size_t rows = result.offsets[i + 1] - result.offsets[i];
+			std::copy_n(buffer.t.begin() + start[i], rows, result.t.begin() + result.offsets[i]);
+			std::copy_n(buffer.points.begin() + start[i], rows, result.points.begin() + result.offsets[i]);
+		}
+	}
+}
+
+void curves::tessellate(const interface_curve& curve, double t0, double t1,
+	const tessellation_options& options, polyline& result)
+{
+	_check(options);
+	result.t.clear();
+	result.points.clear();
+	_tessellator(curve.get_operator_type(), curve.get_baked_form(), options).run(t0, t1, [&result](const _node& v)
+	{
+		result.t.push_back(v.t);
+		result.points.push_back(curve_point(v.p[0], v.p[1], v.p[2]));
+	});
+}
+
+void curves::tessellate(const curve_builder::curve_ptr* curves, std::size_t count, double t0, double t1,
+	const tessellation_options& options, polylines& result)
+{
+	std::vector<_source> sources(count);
+	for (std::size_t i = 0; i < count; ++i)
+		sources[i] = { curves[i]->get_operator_type(), &curves[i]->get_baked_form() };
+	_tessellate(sources, t0, t1, options, result);
+}
+
+void curves::tessellate(const curve_collection& collection, double t0, double t1,
+	const tessellation_options& options, polylines& result)
+{
+	std::vector<_source> sources;
+	sources.reserve(collection.size());
+	for (std::size_t i = 0; i < collection.circles().id.size(); ++i)
+		sources.push_back({ collection.circles().op_type[i], &collection.circles().baked[i] });
+	for (std::size_t i = 0; i < collection.ellipses().id.size(); ++i)
+		sources.push_back({ collection.ellipses().op_type[i], &collection.ellipses().baked[i] });
+	for (std::size_t i = 0; i < collection.helices().id.size(); ++i)
+		sources.push_back({ collection.helices().op_type[i], &collection.helices().baked[i] });
+	_tessellate(sources, t0, t1, options, result);
+}
@@ -0,0 +1,49 @@
+#ifndef _CAD_TESSELLATE
+#define _CAD_TESSELLATE
+
+#include <vector>
+
+#include "collection.hpp"
+
+namespace curves
+{
+	struct tessellation_options
+	{
+		// largest distance between the curve and a polyline segment
+		double chord = 1e-3;
+		// largest turn of the tangent along one segment, in radians
+		double angle = 0.2617993877991494;
+		// a segment is split at most this many times below its initial step
+		unsigned max_depth = 16;
+	};
+
+	struct polyline
+	{
+		std::vector<double> t;
+		std::vector<curve_point> points;
+	};
+
+	// Polylines of many curves: curve k occupies rows offsets[k] to offsets[k + 1].
+	struct polylines
+	{
+		std::vector<std::size_t> offsets;
+		std::vector<double> t;
+		std::vector<curve_point> points;
+	};
+
+	// Steps start from the analytic curvature bound (sagitta kappa * L^2 / 8 <= chord and
+	// kappa * L <= angle), at most pi / 2, and are halved until the distance of the midpoint
+	// from the segment and the tangent turn pass.
+	// Buffers are overwritten; their capacity is reused across calls.
+	DLL_API void tessellate(const interface_curve& curve, double t0, double t1,
+		const tessellation_options& options, polyline& result);
+
+	// Parallel over the curves; the result buffers are resized once per call.
+	DLL_API void tessellate(const curve_builder::curve_ptr* curves, std::size_t count, double t0, double t1,
+		const tessellation_options& options, polylines& result);
+	// Curves follow the bucket order of the collection.
+	DLL_API void tessellate(const curve_collection& collection, double t0, double t1,
+		const tessellation_options& options, polylines& result);
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "writer.hpp"
+#include "reduce.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+	// bytes of text a block of rows may take
+	constexpr std::size_t _budget = std::size_t(1) << 20;
+
+	// Rows are formatted a block at a time into private buffers and appended in block order.
+	// One block per thread is in flight, so a wave holds at most threads() buffers, allocated
+	// once and reused by every wave.
+	template <typename _format>
+	void _write_rows(curves::text_writer& writer, std::size_t count, std::size_t row_size,
+		bool parallel, const _format& format)
+	{
+		const std::size_t rows = std::max<std::size_t>(_budget / row_size, 1);
+		const std::size_t blocks = (count + rows - 1) / rows;
+		const std::size_t wave = parallel ? static_cast<std::size_t>(curves::reduce::threads()) : 1;
+		std::vector<std::vector<char>> buffers(std::min(wave, blocks), std::vector<char>(rows * row_size));
+		std::vector<std::size_t> used(buffers.size());
+		for (std::size_t first = 0; first < blocks; first += buffers.size())
+		{
+			const std::ptrdiff_t n = static_cast<std::ptrdiff_t>(std::min(buffers.size(), blocks - first));
+			#pragma omp parallel for schedule(dynamic) if(parallel)
+			for (std::ptrdiff_t b = 0; b < n; ++b)
+			{
+				std::size_t begin = (first + b) * rows, end = std::min(begin + rows, count);
+				char* out = buffers[b].data();
+				for (std::size_t i = begin; i < end; ++i)
+					out = format(out, i);
+				used[b] = static_cast<std::size_t>(out - buffers[b].data());
+			}
+			for (std::ptrdiff_t b = 0; b < n; ++b)
+				writer.put(buffers[b].data(), used[b]);
+		}
+	}
+}
+
+curves::text_writer::text_writer(const char* path, std::size_t capacity)
+	: _file(std::fopen(path, "wb")), _owned(true), _buffer(std::max(capacity, 4 * max_double))
+{
+	if (_file == nullptr)
+		throw storage_exception("Cannot open file for writing");
+}
+
+curves::text_writer::text_writer(std::FILE* file, std::size_t capacity)
+	: _file(file), _owned(false), _buffer(std::max(capacity, 4 * max_double)) {}
+
+curves::text_writer::~text_writer()
+{
+	try { flush(); }
+	catch (const storage_exception&) {}
+	if (_owned)
+		std::fclose(_file);
+}
+
+char* curves::text_writer::_reserve(std::size_t size)
+{
+	if (_used + size > _buffer.size())
+		flush();
+	return _buffer.data() + _used;
+}
+
+void curves::text_writer::flush()
+{
+	std::size_t used = _used;
+	_used = 0;
+	if (used != 0 && std::fwrite(_buffer.data(), 1, used, _file) != used)
+		throw storage_exception("Cannot write file");
+	if (std::fflush(_file) != 0)
+		throw storage_exception("Cannot write file");
+}
+
+curves::text_writer& curves::text_writer::put(double value)
+{
+	_used = static_cast<std::size_t>(format(_reserve(max_double), value) - _buffer.data());
+	return *this;
+}
+
+curves::text_writer& curves::text_writer::put(char c)
+{
+	*_reserve(1) = c;
+	++_used;
+	return *this;
+}
+
+curves::text_writer& curves::text_writer::put(const char* text)
+{ return put(text, std::strlen(text)); }
+
+curves::text_writer& curves::text_writer::put(const char* data, std::size_t size)
+{
+	if (size > _buffer.size())
+	{
+		flush();
+		if (std::fwrite(data, 1, size, _file) != size)
+			throw storage_exception("Cannot write file");
+		return *this;
+	}
+	std::memcpy(_reserve(size), data, size);
+	_used += size;
+	return *this;
+}
+
+curves::text_writer& curves::text_writer::put(const mv::vec3& v, char separator)
+{
+	char* out = _reserve(3 * max_double + 2);
+	out = format(out, v[0]);
+	*out++ = separator;
+	out = format(out, v[1]);
+	*out++ = separator;
+	out = format(out, v[2]);
+	_used = static_cast<std::size_t>(out - _buffer.data());
+	return *this;
+}
+
+curves::text_writer& curves::text_writer::put(const mv::mat3& m, char separator)
+{
+	for (std::size_t i = 0; i < 3; ++i)
+		put(mv::vec3(m[i][0], m[i][1], m[i][2]), separator).put('\n');
+	return *this;
+}
+
+char* curves::format(char* out, double value) noexcept
+{ return std::to_chars(out, out + text_writer::max_double, value).ptr; }
+
+void curves::write_csv(text_writer& writer, const double* t, const double* x, const double* y, const double* z,
+	std::size_t count, bool parallel)
+{
+	_write_rows(writer, count, 4 * text_writer::max_double + 4, parallel, [=](char* out, std::size_t i)
+	{
+		out = format(out, t[i]);
+		*out++ = ',';
+		out = format(out, x[i]);
+		*out++ = ',';
+		out = format(out, y[i]);
+		*out++ = ',';
+		out = format(out, z[i]);
+		*out++ = '\n';
+		return out;
+	});
+}
+
+void curves::write_csv(text_writer& writer, const curve_point* points, std::size_t count, bool parallel)
+{
+	_write_rows(writer, count, 3 * text_writer::max_double + 3, parallel, [=](char* out, std::size_t i)
+	{
+		out = format(out, points[i][0]);
+		*out++ = ',';
+		out = format(out, points[i][1]);
+		*out++ = ',';
+		out = format(out, points[i][2]);
+		*out++ = '\n';
+		return out;
+	});
+}
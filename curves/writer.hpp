@@ -0,0 +1,58 @@
+#ifndef _CAD_WRITER
+#define _CAD_WRITER
+
+#include <cstdio>
+#include <vector>
+
+#include "curves.hpp"
+#include "exceptions.hpp"
+
+namespace curves
+{
+	// Buffered text output through std::to_chars: no locale, no per-line flush. Doubles are
+	// written in their shortest form that parses back to the same value. Write failures throw
+	// storage_exception; the destructor flushes what is left and ignores errors.
+	class text_writer final
+	{
+		std::FILE* _file;
+		bool _owned;
+		std::vector<char> _buffer;
+		std::size_t _used = 0;
+
+		char* _reserve(std::size_t size);
+	public:
+		static constexpr std::size_t default_capacity = std::size_t(1) << 22;
+		// longest shortest-form double, e.g. -2.2250738585072014e-308
+		static constexpr std::size_t max_double = 24;
+
+		DLL_API explicit text_writer(const char* path, std::size_t capacity = default_capacity);
+		// file stays open after destruction, e.g. stdout
+		DLL_API explicit text_writer(std::FILE* file, std::size_t capacity = default_capacity);
+		DLL_API ~text_writer();
+
+		text_writer(const text_writer&) = delete;
+		text_writer& operator=(const text_writer&) = delete;
+
+		DLL_API text_writer& put(double value);
+		DLL_API text_writer& put(char c);
+		DLL_API text_writer& put(const char* text);
+		DLL_API text_writer& put(const char* data, std::size_t size);
+		DLL_API text_writer& put(const mv::vec3& v, char separator = ' ');
+		// three rows, each ended by a newline
+		DLL_API text_writer& put(const mv::mat3& m, char separator = ' ');
+
+		DLL_API void flush();
+	};
+
+	// Writes at most text_writer::max_double characters and returns the end.
+	DLL_API char* format(char* out, double value) noexcept;
+
+	// One "t,x,y,z" row per sample. With parallel set, blocks of rows are formatted by all
+	// threads into private buffers and written in order, so the output does not change.
+	DLL_API void write_csv(text_writer& writer, const double* t, const double* x, const double* y, const double* z,
+		std::size_t count, bool parallel = false);
+	// One "x,y,z" row per point.
+	DLL_API void write_csv(text_writer& writer, const curve_point* points, std::size_t count, bool parallel = false);
+}
+
+#endif
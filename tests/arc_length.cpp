@@ -0,0 +1,163 @@
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "check.hpp"
+#include "arc_length.hpp"
+
+namespace
+{
+	const double _pi = 3.14159265358979323846;
+
+	double _hypot(const double* v) { return std::hypot(v[0], v[1], v[2]); }
+
+	// Perimeter of an ellipse from the arithmetic-geometric mean, independent of any quadrature:
+	// 2 pi (a^2 - sum 2^(n-1) c_n^2) / agm(a, b), c_0^2 = a^2 - b^2.
+	double _perimeter(double a, double b)
+	{
+		double square = a * a, sum = 0.5 * (a * a - b * b), weight = 0.5;
+		while (std::abs(a - b) > 1e-15 * a)
+		{
+			double c = 0.5 * (a - b);
+			weight *= 2.0;
+			sum += weight * c * c;
+			double g = std::sqrt(a * b);
+			a = 0.5 * (a + b);
+			b = g;
+		}
+		return 2.0 * _pi * (square - sum) / a;
+	}
+
+	bool _close(double a, double b, double tolerance) { return std::abs(a - b) <= tolerance * (1.0 + std::abs(b)); }
+
+	mv::mat3 _shear()
+	{
+		mv::mat3 m = mv::rotate_euler(mv::vec3(0.4, 1.3, -0.7));
+		m[0][1] += 0.6;
+		m[2][0] -= 1.1;
+		m[1][2] += 0.3;
+		return m;
+	}
+}
+
+// Constant-speed curves in closed form: the table integrates them all the same.
+TEST(arc_length_closed_form)
+{
+	std::vector<curves::curve_builder::curve_ptr> population = {
+		curves::curve_builder::make_curve<curves::CIRCLE>(3.0),
+		curves::curve_builder::make_curve<curves::CIRCLE>(0.25, mv::rotate_euler(mv::vec3(1.0, 0.2, -0.5))),
+		curves::curve_builder::make_curve<curves::HELIX>(2.0, 5.0),
+		curves::curve_builder::make_curve<curves::HELIX>(7.0, 0.5, mv::rotate_euler(mv::vec3(-0.3, 2.1, 0.9))) };
+	const double ranges[][2] = { { 0.0, 2.0 * _pi }, { -3.0, 0.1 }, { 4.0, 41.5 }, { 5.0, -2.0 } };
+	for (const auto& curve : population)
+	{
+		const curves::baked_form& k = curve->get_baked_form();
+		double speed = std::sqrt(0.5 * (_hypot(k.a) * _hypot(k.a) + _hypot(k.b) * _hypot(k.b)) + _hypot(k.c) * _hypot(k.c)), reported;
+		CHECK(curves::constant_speed(k, reported) && _close(reported, speed, 1e-14));
+		curves::arc_length_table table(*curve);
+		for (const auto& range : ranges)
+		{
+			double exact = speed * (range[1] - range[0]);
+			CHECK(_close(curves::arc_length(*curve, range[0], range[1]), exact, 1e-14));
+			CHECK(_close(table.length(range[0], range[1]), exact, 1e-12));
+		}
+	}
+}
+
+// Ellipse perimeters, down to a nearly flat one whose speed almost vanishes at the ends of the
+// major axis, from quadrature and from the table against the AGM.
+TEST(arc_length_ellipse_perimeter)
+{
+	const double axes[][2] = { { 1.0, 1.0 }, { 3.0, 1.0 }, { 10.0, 0.1 }, { 2.0, 0.002 } };
+	for (const auto& axis : axes)
+	{
+		double perimeter = _perimeter(axis[0], axis[1]);
+		curves::curve_builder::curve_ptr ellipse = curves::curve_builder::make_curve<curves::ELLIPSE>(axis[0], axis[1],
+			mv::rotate_euler(mv::vec3(0.5, -0.2, 1.7)));
+		curves::arc_length_table table(*ellipse);
+		CHECK(_close(curves::arc_length(*ellipse, 0.0, 2.0 * _pi), perimeter, 1e-12));
+		CHECK(_close(curves::arc_length(*ellipse, -7.0, 3.0 * 2.0 * _pi - 7.0), 3.0 * perimeter, 1e-12));
+		CHECK(_close(2.0 * table.length(0.0, _pi), perimeter, 1e-12));
+		CHECK(_close(table.length(1.0, 1.0 + 4.0 * _pi), 2.0 * perimeter, 1e-12));
+	}
+}
+
+// Sheared curves of varying speed: quadrature and table agree on arbitrary ranges, each
+// whole period adds one period length, and lengths add up across a split.
+TEST(arc_length_quadrature_matches_table)
+{
+	std::vector<curves::curve_builder::curve_ptr> population = {
+		curves::curve_builder::make_curve<curves::ELLIPSE>(4.0, 0.5, _shear()),
+		curves::curve_builder::make_curve<curves::HELIX>(1.5, 3.0, _shear()),
+		curves::curve_builder::make_curve<curves::HELIX>(6.0, 0.2, _shear()) };
+	const double ranges[][2] = { { 0.0, 0.3 }, { -2.5, 1.0 }, { 0.7, 29.0 }, { 12.0, -40.0 }, { 100.0, 100.25 } };
+	for (const auto& curve : population)
+	{
+		double speed;
+		CHECK(!curves::constant_speed(curve->get_baked_form(), speed));
+		curves::arc_length_table table(*curve), fine(curve->get_operator_type(), curve->get_baked_form(), 1000);
+		CHECK(_close(table.period_length(), curves::arc_length(*curve, 0.0, table.period()), 1e-13));
+		CHECK(_close(fine.period_length(), table.period_length(), 1e-13));
+		for (const auto& range : ranges)
+		{
+			double length = curves::arc_length(*curve, range[0], range[1]), middle = 0.5 * (range[0] + range[1]);
+			CHECK(_close(table.length(range[0], range[1]), length, 1e-12));
+			CHECK(_close(fine.length(range[0], range[1]), length, 1e-12));
+			CHECK(_close(curves::arc_length(*curve, range[0], middle) + curves::arc_length(*curve, middle, range[1]), length, 1e-12));
+			CHECK(_close(curves::arc_length(*curve, range[0], range[1] + 2.0 * table.period()) - length,
+				2.0 * table.period_length(), 1e-12));
+		}
+	}
+}
+
+namespace
+{
+	// Samples i lie at length i ds from t0 by quadrature, in order, at the points of their t;
+	// stride thins out the quadrature on long runs.
+	bool _equidistant(const curves::interface_curve& curve, double t0, double t1, std::size_t n, std::size_t stride)
+	{
+		curves::arc_length_table table(curve);
+		std::vector<curves::curve_point> values(n);
+		std::vector<double> t(n);
+		table.sample_equidistant(t0, t1, n, values.data(), t.data());
+		double length = curves::arc_length(curve, t0, t1), ds = length / static_cast<double>(n - 1);
+		bool ordered = t.front() == t0 && t.back() == t1;
+		for (std::size_t i = 1; i < n; ++i)
+			ordered = ordered && (t1 > t0 ? t[i] > t[i - 1] : t[i] < t[i - 1]);
+		double worst = 0.0, position = 0.0;
+		auto measure = [&](std::size_t i)
+		{
+			curves::curve_point p = curve.get_value(t[i]);
+			worst = std::max(worst, std::abs(curves::arc_length(curve, t0, t[i]) - ds * static_cast<double>(i)));
+			position = std::max(position, std::hypot(p[0] - values[i][0], p[1] - values[i][1], p[2] - values[i][2]));
+		};
+		for (std::size_t i = 0; i < n; i += stride)
+			measure(i);
+		measure(n - 1);
+		for (std::size_t i = 0; i <= 1000; ++i)
+		{
+			double s = table(t0) + 1e-3 * static_cast<double>(i) * length;
+			worst = std::max(worst, std::abs(table(table.parameter(s)) - s));
+		}
+		return ordered && worst <= 1e-12 * std::abs(length) && position <= 1e-12 * (1.0 + std::abs(length));
+	}
+}
+
+// Walks across the sharp speed minima of a flat ellipse, where one step of the walk spans many
+// times the scale of the speed, and along sheared helices whose steps are long enough for the
+// second-order prediction to miss.
+TEST(arc_length_equidistant_samples)
+{
+	curves::curve_builder::curve_ptr circle = curves::curve_builder::make_curve<curves::CIRCLE>(3.0),
+		flat = curves::curve_builder::make_curve<curves::ELLIPSE>(2.0, 0.002),
+		steep = curves::curve_builder::make_curve<curves::HELIX>(1.5, 3.0, _shear()),
+		wide = curves::curve_builder::make_curve<curves::HELIX>(6.0, 0.2, _shear());
+	CHECK(_equidistant(*circle, -1.0, 8.0, 1001, 1));
+	CHECK(_equidistant(*circle, 0.0, 100.0, 100001, 97));
+	CHECK(_equidistant(*flat, 0.0, 9.0, 100001, 7));
+	CHECK(_equidistant(*flat, 9.0, -0.5, 1001, 1));
+	CHECK(_equidistant(*flat, 0.0, 9.0, 101, 1));
+	CHECK(_equidistant(*steep, 0.0, 9.0, 1001, 1));
+	CHECK(_equidistant(*wide, -3.0, 20.0, 1001, 1));
+	CHECK(_equidistant(*wide, 20.0, -3.0, 100001, 97));
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "check.hpp"
+#include "curves.hpp"
+#include "proximity.hpp"
+#include "reduce.hpp"
+
+namespace
+{
+	// best of a few runs, in nanoseconds per point
+	template <typename _body>
+	double _time(std::size_t points, const _body& body)
+	{
+		double best = 0.0;
+		for (std::size_t run = 0; run < 5; ++run)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			best = run == 0 ? ns : std::min(best, ns);
+		}
+		return best / static_cast<double>(points);
+	}
+}
+
+// sample_uniform against a get_value loop over the same grid, 100k samples of a rotated helix.
+BENCHMARK(sample_uniform_vs_get_value)
+{
+	const std::size_t n = 100000;
+	const double t0 = -3.0, dt = 1e-3;
+	auto helix = curves::curve_builder::make_curve<curves::HELIX>(10.0, 2.0, mv::rotate_euler(mv::vec3(0.3, -1.1, 2.0)));
+	std::vector<curves::curve_point> points(n);
+	std::vector<double> t(n), x(n), y(n), z(n);
+	for (std::size_t k = 0; k < n; ++k)
+		t[k] = t0 + dt * static_cast<double>(k);
+
+	double naive = _time(n, [&] { for (std::size_t k = 0; k < n; ++k) points[k] = helix->get_value(t[k]); });
+	double batch = _time(n, [&] { helix->get_values(t.data(), n, x.data(), y.data(), z.data()); });
+	double aos = _time(n, [&] { helix->sample_uniform(t0, dt, n, points.data()); });
+	double soa = _time(n, [&] { helix->sample_uniform(t0, dt, n, x.data(), y.data(), z.data()); });
+	std::cout << "  get_value loop       " << naive << " ns/pt\n"
+		<< "  get_values (simd)    " << batch << " ns/pt\n"
+		<< "  sample_uniform AoS   " << aos << " ns/pt\n"
+		<< "  sample_uniform SoA   " << soa << " ns/pt" << std::endl;
+	CHECK(points[n - 1][0] == x[n - 1]);
+}
+
+// close_pairs over 10^6 curves trimmed to a tenth of a radian, each under a random operator,
+// within 1e-3. Whole turns of as many curves crowd around the origin so densely that the close
+// pairs alone grow with the square of the count.
+BENCHMARK(close_pairs_million)
+{
+	curves::random_options options;
+	options.operator_probability = 1.0;
+	curves::curve_collection collection;
+	collection.add_random(1000000, 7, options);
+	std::vector<curves::close_pair> pairs;
+	auto start = std::chrono::steady_clock::now();
+	curves::close_pairs(collection, 1e-3, 0.0, 0.1, pairs);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "  close_pairs          " << seconds << " s, " << pairs.size() << " pairs on "
+		<< curves::reduce::threads() << " threads" << std::endl;
+	CHECK(!pairs.empty());
+}
@@ -0,0 +1,60 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "bounds.hpp"
+
+namespace
+{
+	// The box holds every sample of [t0, t1] and each face is touched by one, up to the
+	// sagitta of the sampling step.
+	bool _tight(const curves::baked_form& k, double t0, double t1)
+	{
+		const std::size_t n = 100000;
+		curves::aabb box = curves::bounds(k, t0, t1), sampled = curves::aabb::empty();
+		double scale = 0.0;
+		for (std::size_t i = 0; i < 3; ++i)
+			scale = std::max(scale, std::abs(k.a[i]) + std::abs(k.b[i]) + std::abs(k.c[i]) * std::max(std::abs(t0), std::abs(t1)));
+		for (std::size_t i = 0; i <= n; ++i)
+		{
+			double t = i == n ? t1 : t0 + (t1 - t0) * static_cast<double>(i) / n, p[3];
+			curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t, p[0], p[1], p[2]);
+			sampled.expand(p);
+		}
+		double dt = std::abs(t1 - t0) / n, slack = 1e-12 * (1.0 + scale), sagitta = dt * dt * scale + slack;
+		for (std::size_t i = 0; i < 3; ++i)
+			if (sampled.min[i] < box.min[i] - slack || sampled.max[i] > box.max[i] + slack
+				|| sampled.min[i] > box.min[i] + sagitta || sampled.max[i] < box.max[i] - sagitta)
+				return false;
+		return true;
+	}
+}
+
+// Random curves under random operators over ranges from a sliver to many turns, both ways round,
+// and the flat cases: a straight ellipse, and a helix whose pitch just stops an axis turning back.
+TEST(bounds_match_dense_sampling)
+{
+	std::mt19937_64 engine(23);
+	std::uniform_real_distribution<double> entry(-1.0, 1.0), radius(0.5, 20.0), start(-30.0, 30.0), span(-4.0, 2.0);
+	std::size_t failures = 0;
+	for (std::size_t trial = 0; trial < 200; ++trial)
+	{
+		mv::mat3 m;
+		for (auto e = m.begin(); e != m.end(); ++e)
+			*e = entry(engine);
+		curves::curve_builder::curve_ptr curve = trial % 3 == 0 ? curves::curve_builder::make_curve<curves::CIRCLE>(radius(engine), m)
+			: trial % 3 == 1 ? curves::curve_builder::make_curve<curves::ELLIPSE>(radius(engine), radius(engine), m)
+			: curves::curve_builder::make_curve<curves::HELIX>(radius(engine), radius(engine), m);
+		double t0 = start(engine), t1 = t0 + (trial % 2 ? 1.0 : -1.0) * std::pow(10.0, span(engine)) * 20.0;
+		if (!_tight(curve->get_baked_form(), t0, t1))
+			++failures;
+	}
+	CHECK(failures == 0);
+
+	curves::baked_form straight = { { 2.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+	curves::baked_form edge = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 1.0, 0.0, 0.5 } };
+	CHECK(_tight(straight, -1.0, 2.0) && _tight(straight, 0.5, 40.0));
+	CHECK(_tight(edge, -7.0, 7.0) && _tight(edge, 0.2, 0.3));
+}
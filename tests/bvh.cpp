@@ -0,0 +1,171 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "bvh.hpp"
+#include "reduce.hpp"
+
+namespace
+{
+	struct _curve
+	{
+		curves::aabb box;
+		curves::curve_id id;
+	};
+
+	// Slab test written out on the grown box, the axes parallel to the ray on their own.
+	bool _hits(const curves::ray& r, double tolerance, const curves::aabb& box)
+	{
+		double enter = 0.0, leave = HUGE_VAL;
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			double lo = box.min[i] - tolerance, hi = box.max[i] + tolerance;
+			if (r.direction[i] == 0.0)
+			{
+				if (r.origin[i] < lo || r.origin[i] > hi)
+					return false;
+				continue;
+			}
+			double a = (lo - r.origin[i]) / r.direction[i], b = (hi - r.origin[i]) / r.direction[i];
+			enter = std::max(enter, std::min(a, b));
+			leave = std::min(leave, std::max(a, b));
+		}
+		return enter <= leave;
+	}
+
+	template <typename _overlaps>
+	bool _same(const std::vector<_curve>& population, const _overlaps& overlaps, std::vector<curves::curve_id> found)
+	{
+		std::vector<curves::curve_id> expected;
+		for (const _curve& curve : population)
+			if (overlaps(curve.box))
+				expected.push_back(curve.id);
+		std::sort(expected.begin(), expected.end());
+		std::sort(found.begin(), found.end());
+		return found == expected;
+	}
+
+	// Every kind of query on random regions against a scan of the boxes.
+	bool _queries(const curves::bvh& tree, const std::vector<_curve>& population, std::mt19937_64& engine)
+	{
+		std::uniform_real_distribution<double> coordinate(-60.0, 60.0), extent(0.0, 20.0), unit(-1.0, 1.0);
+		std::vector<curves::curve_id> found;
+		for (std::size_t trial = 0; trial < 50; ++trial)
+		{
+			curves::aabb box;
+			double center[3], radius = extent(engine), tolerance = 0.1 * extent(engine);
+			curves::ray r;
+			curves::frustum region;
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				box.min[i] = coordinate(engine);
+				box.max[i] = box.min[i] + extent(engine);
+				center[i] = coordinate(engine);
+				r.origin[i] = coordinate(engine);
+				r.direction[i] = trial % 5 == 0 && i == trial % 3 ? 0.0 : unit(engine);
+			}
+			for (std::size_t i = 0; i < 6; ++i)
+			{
+				for (std::size_t j = 0; j < 3; ++j)
+					region.plane[i][j] = unit(engine);
+				region.plane[i][3] = 30.0 * unit(engine);
+			}
+
+			found.clear();
+			tree.query(box, found);
+			if (!_same(population, [&box](const curves::aabb& other) { return box.overlaps(other); }, found))
+				return false;
+			found.clear();
+			tree.query(center, radius, found);
+			if (!_same(population, [&center, radius](const curves::aabb& other)
+			{
+				double d2 = 0.0;
+				for (std::size_t i = 0; i < 3; ++i)
+				{
+					double d = std::max(std::max(other.min[i] - center[i], center[i] - other.max[i]), 0.0);
+					d2 += d * d;
+				}
+				return d2 <= radius * radius;
+			}, found))
+				return false;
+			found.clear();
+			tree.query(region, found);
+			if (!_same(population, [&region](const curves::aabb& other) { return region.overlaps(other); }, found))
+				return false;
+			auto hits = [&r, tolerance](const curves::aabb& other) { return _hits(r, tolerance, other); };
+			found.clear();
+			tree.query(r, tolerance, found);
+			if (!_same(population, hits, found))
+				return false;
+			found.clear();
+			tree.query(r, tolerance, [&found](curves::curve_id id) { found.push_back(id); return HUGE_VAL; });
+			if (!_same(population, hits, found))
+				return false;
+		}
+		return true;
+	}
+
+	std::vector<_curve> _boxes(const curves::curve_collection& collection, double t0, double t1)
+	{
+		std::vector<_curve> result;
+		for (curves::curve_id id = 0; id < collection.next_id(); ++id)
+			if (collection.find(id).index != curves::curve_collection::npos)
+				result.push_back({ curves::bounds(*collection.make_curve(id), t0, t1), id });
+		return result;
+	}
+}
+
+// Trees over a random population, with boxes from one turn and from part of one, then
+// over what is left once a third of the curves are erased and a few more added.
+TEST(bvh_queries_match_brute_force)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(3000, 31, options);
+	std::mt19937_64 engine(41);
+	for (double t1 : { 6.283185307179586, 3.0 })
+	{
+		curves::bvh tree(collection, 0.0, t1);
+		CHECK(tree.size() == collection.size());
+		CHECK(_queries(tree, _boxes(collection, 0.0, t1), engine));
+	}
+
+	for (curves::curve_id id = 0; id < 3000; id += 3)
+		collection.erase(id);
+	collection.add_helix(4.0, 2.0);
+	collection.add_circle(55.0);
+	curves::bvh tree(collection, -2.0, 5.0);
+	std::vector<_curve> population = _boxes(collection, -2.0, 5.0);
+	CHECK(tree.size() == population.size() && population.size() == 2002);
+	CHECK(_queries(tree, population, engine));
+
+	std::vector<curves::curve_id> found;
+	curves::bvh().query(curves::aabb{ { -1.0, -1.0, -1.0 }, { 1.0, 1.0, 1.0 } }, found);
+	CHECK(found.empty());
+}
+
+// Trees large enough to be split into subtrees built on several threads: the same leaves in the
+// same order on any number of threads, and the queries of the parallel one still exact.
+TEST(bvh_parallel_build_matches_serial)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(70000, 8, options);
+	const int before = curves::reduce::threads();
+	tests::set_threads(1);
+	curves::bvh serial(collection, 0.0, 4.0);
+	tests::set_threads(4);
+	curves::bvh parallel(collection, 0.0, 4.0);
+	tests::set_threads(before);
+	CHECK(serial.size() == 70000 && parallel.size() == 70000 && serial.nodes().size() == parallel.nodes().size());
+	std::size_t mismatches = 0;
+	for (std::size_t i = 0; i < serial.size(); ++i)
+		mismatches += serial.id(i) != parallel.id(i);
+	CHECK(mismatches == 0);
+	std::mt19937_64 engine(12);
+	CHECK(_queries(parallel, _boxes(collection, 0.0, 4.0), engine));
+}
@@ -0,0 +1,43 @@
+#ifndef _CAD_TESTS_CHECK
+#define _CAD_TESTS_CHECK
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace tests
+{
+	using function = void (*)();
+
+	// Adds a test, or a benchmark run only with --benchmark, to the list main() walks.
+	struct registration
+	{
+		registration(const char* name, function body, bool benchmark = false);
+	};
+
+	void fail(const char* file, int line, const char* expression);
+
+	// OpenMP team size for the following parallel regions; a no-op without OpenMP.
+	inline void set_threads(int threads)
+	{
+#ifdef _OPENMP
+		omp_set_num_threads(threads);
+#else
+		static_cast<void>(threads);
+#endif
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static const tests::registration name##_registration(#name, name); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static const tests::registration name##_registration(#name, name, true); \
+	static void name()
+
+#define CHECK(expression) ((expression) ? (void)0 : tests::fail(__FILE__, __LINE__, #expression))
+
+#endif
@@ -0,0 +1,168 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "closest_point.hpp"
+#include "numeric.hpp"
+
+namespace
+{
+	double _distance(const curves::baked_form& k, double t, const double* q)
+	{
+		double x, y, z;
+		curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t, x, y, z);
+		return std::hypot(x - q[0], y - q[1], z - q[2]);
+	}
+
+	// Smallest distance over 20001 samples of [t0, t1], each refined by golden section within
+	// its neighbours when it beats both: an upper bound on the true minimum.
+	double _sampled(const curves::baked_form& k, const double* q, double t0, double t1)
+	{
+		const std::size_t n = 20000;
+		double h = (t1 - t0) / n, best = HUGE_VAL;
+		std::vector<double> d(n + 1);
+		for (std::size_t i = 0; i <= n; ++i)
+			d[i] = _distance(k, t0 + h * static_cast<double>(i), q);
+		for (std::size_t i = 0; i <= n; ++i)
+		{
+			best = std::min(best, d[i]);
+			if (i == 0 || i == n || d[i] > d[i - 1] || d[i] > d[i + 1])
+				continue;
+			double lo = t0 + h * (i - 1.0), hi = t0 + h * (i + 1.0);
+			for (std::size_t step = 0; step < 60; ++step)
+			{
+				double m0 = hi - 0.6180339887498949 * (hi - lo), m1 = lo + 0.6180339887498949 * (hi - lo);
+				if (_distance(k, m0, q) < _distance(k, m1, q))
+					hi = m1;
+				else
+					lo = m0;
+			}
+			best = std::min(best, _distance(k, 0.5 * (lo + hi), q));
+		}
+		return best;
+	}
+
+	// The result is a real point of the curve at its t, within [t0, t1], and no sample beats it.
+	bool _closest(const curves::baked_form& k, const curves::closest_point& found, const double* q,
+		double t0, double t1)
+	{
+		double reference = _sampled(k, q, t0, t1);
+		return found.t >= t0 - 1e-12 && found.t <= t1 + 1e-12
+			&& std::abs(_distance(k, found.t, q) - found.distance) <= 1e-9 * (1.0 + found.distance)
+			&& found.distance <= reference + 1e-9 * (1.0 + reference);
+	}
+
+	curves::baked_form _form(double Rx, double Ry, double h, const mv::mat3& op)
+	{ return curves::bake(op, Rx, Ry, h); }
+}
+
+// Rotated and sheared ellipses, from a flat one to circles perturbed by 1e-4 and 1e-11, with
+// query points anywhere, near the centre and on the axes, over a turn and over partial ranges.
+TEST(projector_matches_sampling_on_ellipses)
+{
+	std::mt19937_64 engine(17);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	mv::mat3 general;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	const double ratios[] = { 0.05, 0.6, 1.0 - 1e-4, 1.0 - 1e-11, 1.0 };
+	std::size_t failures = 0;
+	for (std::size_t trial = 0; trial < 20; ++trial)
+	{
+		mv::mat3 op = trial % 4 == 3 ? general : mv::rotate_euler(mv::vec3(3.0 * unit(engine), 3.0 * unit(engine), 3.0 * unit(engine)));
+		double Rx = 1.0 + 9.0 * std::abs(unit(engine));
+		curves::baked_form k = _form(Rx, Rx * ratios[trial % 5], 0.0, op);
+		curves::projector project(k);
+		for (std::size_t point = 0; point < 12; ++point)
+		{
+			double q[3];
+			double scale = point < 4 ? 1e-3 : point < 8 ? 1.0 : 2.0 * Rx;
+			for (std::size_t i = 0; i < 3; ++i)
+				q[i] = scale * unit(engine);
+			failures += !_closest(k, project(q[0], q[1], q[2]), q, 0.0, curves::numeric::two_pi);
+			double t0 = 4.0 * unit(engine), t1 = t0 + 3.0 * std::abs(unit(engine));
+			failures += !_closest(k, project(q[0], q[1], q[2], t0, t1), q, t0, t1);
+		}
+	}
+	CHECK(failures == 0);
+}
+
+// Helices from tight to steep, rotated and sheared, with query points on and near the axis,
+// where every point of a turn is almost equally far, and off it. Unbounded queries are checked
+// over every turn that can come closest, ranged ones over their range.
+TEST(projector_matches_sampling_on_helices)
+{
+	std::mt19937_64 engine(29);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	mv::mat3 general;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	const double offsets[] = { 0.0, 1e-9, 1e-4, 0.3, 3.0 };
+	std::size_t failures = 0;
+	for (std::size_t trial = 0; trial < 16; ++trial)
+	{
+		bool sheared = trial % 4 == 3;
+		mv::mat3 op = sheared ? general : mv::rotate_euler(mv::vec3(3.0 * unit(engine), 3.0 * unit(engine), 3.0 * unit(engine)));
+		double R = 1.0 + 4.0 * std::abs(unit(engine)), h = std::pow(10.0, 1.5 * unit(engine));
+		curves::baked_form k = _form(R, R, h, op);
+		curves::projector project(k);
+		const double axis[3] = { k.c[0], k.c[1], k.c[2] };
+		for (std::size_t point = 0; point < 15; ++point)
+		{
+			double q[3], s = 20.0 * unit(engine);
+			for (std::size_t i = 0; i < 3; ++i)
+				q[i] = s * axis[i] + offsets[point % 5] * unit(engine);
+			double t0 = -10.0, t1 = 10.0;
+			failures += !_closest(k, project(q[0], q[1], q[2], t0, t1), q, t0, t1);
+			if (sheared)
+				continue;
+			// beyond (R + |offset|) / h of the point abreast the axial gap alone is farther than any turn
+			double abreast = curves::numeric::dot(q, axis) / curves::numeric::dot(axis, axis);
+			double window = 3.0 * curves::numeric::two_pi + (R + 6.0) / h;
+			failures += !_closest(k, project(q[0], q[1], q[2]), q, abreast - window, abreast + window);
+		}
+	}
+	CHECK(failures == 0);
+}
+
+// closest_points shares one projector among the pairs of a curve; every pair still gets the
+// answer of its own projector.
+TEST(closest_points_match_projectors)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(40, 9, options);
+	std::mt19937_64 engine(4);
+	std::uniform_real_distribution<double> unit(-30.0, 30.0);
+	std::uniform_int_distribution<curves::curve_id> pick(0, 39);
+	const std::size_t n = 3000;
+	std::vector<curves::curve_builder::curve_ptr> built(40);
+	for (curves::curve_id id = 0; id < 40; ++id)
+		built[id] = collection.make_curve(id);
+	std::vector<curves::curve_id> ids(n);
+	std::vector<curves::curve_builder::curve_ptr> shared(n);
+	std::vector<curves::curve_point> points(n);
+	std::vector<double> x(n), y(n), z(n), t(n), d(n), pt(n), pd(n);
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		ids[i] = pick(engine);
+		shared[i] = built[ids[i]];
+		x[i] = points[i][0] = unit(engine);
+		y[i] = points[i][1] = unit(engine);
+		z[i] = points[i][2] = unit(engine);
+	}
+	curves::closest_points(collection, ids.data(), x.data(), y.data(), z.data(), n, t.data(), d.data());
+	curves::closest_points(shared.data(), points.data(), n, pt.data(), pd.data());
+	std::size_t mismatches = 0;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		curves::closest_point expected = curves::projector(*shared[i])(points[i]);
+		mismatches += t[i] != expected.t || d[i] != expected.distance || pt[i] != expected.t || pd[i] != expected.distance;
+	}
+	CHECK(mismatches == 0);
+}
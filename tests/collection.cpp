@@ -0,0 +1,232 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "closest_point.hpp"
+
+namespace
+{
+	bool _throws(const curves::curve_collection& collection, curves::curve_id id)
+	{
+		try
+		{
+			collection.make_curve(id);
+		}
+		catch (const curves::curve_builder::build_exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	bool _less(const curves::radius_index::entry& a, const curves::radius_index::entry& b)
+	{ return a.R < b.R || (a.R == b.R && a.id < b.id); }
+
+	// The index against the circle bucket sorted from scratch, with its range queries.
+	bool _matches(const curves::curve_collection& collection, std::mt19937_64& engine)
+	{
+		std::vector<curves::radius_index::entry> reference;
+		for (std::size_t i = 0; i < collection.circles().id.size(); ++i)
+			reference.push_back({ collection.circles().R[i], collection.circles().id[i] });
+		std::sort(reference.begin(), reference.end(), _less);
+		const curves::radius_index& index = collection.circle_radii();
+		if (index.pending() || index.size() != reference.size())
+			return false;
+		for (std::size_t i = 0; i < reference.size(); ++i)
+			if (index.begin()[i].R != reference[i].R || index.begin()[i].id != reference[i].id)
+				return false;
+
+		std::uniform_real_distribution<double> radius(0.0, 12.0);
+		for (std::size_t trial = 0; trial < 20; ++trial)
+		{
+			double a = radius(engine), b = radius(engine);
+			std::size_t k = static_cast<std::size_t>(radius(engine));
+			auto range = index.range(a, b);
+			std::size_t first = 0, last = 0;
+			double sum = 0.0;
+			for (std::size_t i = 0; i < reference.size(); ++i)
+			{
+				first += reference[i].R < a;
+				last += reference[i].R <= b;
+				if (reference[i].R >= a && reference[i].R <= b)
+					sum += reference[i].R;
+			}
+			last = std::max(first, last);
+			auto top = index.top(k);
+			if (static_cast<std::size_t>(range.first - index.begin()) != first
+				|| static_cast<std::size_t>(range.second - index.begin()) != last
+				|| std::abs(index.sum(a, b) - sum) > 1e-9 * (1.0 + sum)
+				|| static_cast<std::size_t>(top.second - top.first) != std::min(k, reference.size())
+				|| top.second != index.end())
+				return false;
+		}
+		return true;
+	}
+
+	// Point i of the collection in bucket order (of one bucket when type is given) against its
+	// curve built on its own; the table sines come from the SIMD kernels, within their tolerance.
+	bool _at(const curves::curve_collection& collection, const curves::curve_id* ids, std::size_t count,
+		double t, bool derivative, const double* x, const double* y, const double* z)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			curves::curve_builder::curve_ptr curve = collection.make_curve(ids[i]);
+			curves::curve_point p = derivative ? curve->get_d_dt_value(t) : curve->get_value(t);
+			const curves::baked_form& k = curve->get_baked_form();
+			const double q[3] = { x[i], y[i], z[i] };
+			for (std::size_t j = 0; j < 3; ++j)
+			{
+				double scale = std::abs(k.a[j]) + std::abs(k.b[j]) + std::abs(k.c[j]) * (1.0 + std::abs(t));
+				if (std::abs(q[j] - p[j]) > 1e-13 * scale)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(collection_find_rejects_erased_and_unknown_ids)
+{
+	curves::curve_collection collection;
+	curves::curve_id circle = collection.add_circle(2.0), ellipse = collection.add_ellipse(3.0, 1.0),
+		helix = collection.add_helix(1.0, 0.5);
+	collection.erase(ellipse);
+
+	CHECK(collection.find(circle).type == curves::CIRCLE && collection.find(circle).index == 0);
+	CHECK(collection.find(helix).type == curves::HELIX && collection.find(helix).index == 0);
+	CHECK(collection.find(ellipse).index == curves::curve_collection::npos);
+	CHECK(collection.find(helix + 1).index == curves::curve_collection::npos);
+	CHECK(collection.find(curves::curve_collection::npos).index == curves::curve_collection::npos);
+
+	CHECK(collection.make_curve(helix)->get_type() == curves::HELIX);
+	CHECK(_throws(collection, ellipse));
+	CHECK(_throws(collection, helix + 1));
+}
+
+TEST(closest_points_rejects_erased_ids)
+{
+	curves::curve_collection collection;
+	curves::curve_id first = collection.add_circle(2.0), second = collection.add_helix(1.0, 0.5);
+	const double x[2] = { 3.0, 3.0 }, y[2] = { 0.0, 0.0 }, z[2] = { 0.0, 0.0 };
+	double t[2], distance[2];
+	curves::curve_id ids[2] = { first, second };
+	curves::closest_points(collection, ids, x, y, z, 2, t, distance);
+	CHECK(std::abs(distance[0] - 1.0) < 1e-12);
+
+	collection.erase(second);
+	bool thrown = false;
+	try
+	{
+		curves::closest_points(collection, ids, x, y, z, 2, t, distance);
+	}
+	catch (const curves::curve_builder::build_exception&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+// Inserts and erases, some cancelling within one batch, merged at random points.
+TEST(radius_index_matches_sorted_reference)
+{
+	std::mt19937_64 engine(7);
+	std::uniform_real_distribution<double> radius(1.0, 10.0), coin(0.0, 1.0);
+	curves::curve_collection collection;
+	std::vector<curves::curve_id> alive;
+	for (std::size_t round = 0; round < 40; ++round)
+	{
+		std::size_t edits = 1 + static_cast<std::size_t>(coin(engine) * 200.0);
+		for (std::size_t e = 0; e < edits; ++e)
+			if (alive.empty() || coin(engine) < 0.6)
+			{
+				// a few equal radii exercise the ordering by id
+				double R = coin(engine) < 0.1 ? 5.0 : radius(engine);
+				alive.push_back(coin(engine) < 0.8 ? collection.add_circle(R) : collection.add_helix(R, 1.0));
+			}
+			else
+			{
+				std::size_t i = static_cast<std::size_t>(coin(engine) * static_cast<double>(alive.size())) % alive.size();
+				collection.erase(alive[i]);
+				alive[i] = alive.back();
+				alive.pop_back();
+			}
+		if (coin(engine) < 0.7)
+			CHECK(_matches(collection, engine));
+	}
+	CHECK(_matches(collection, engine));
+	collection.clear();
+	CHECK(collection.circle_radii().size() == 0 && collection.next_id() == 0);
+}
+
+// Every overload of get_values_at and get_d_dt_values_at, per bucket, over the collection and
+// from a table, for each operator class and after erasure has reordered the buckets.
+TEST(collection_values_at_match_curves)
+{
+	mv::mat3 diagonal, rotated = mv::rotate_euler(mv::vec3(0.3, -1.1, 2.0)), general;
+	diagonal[0][0] = 2.0;
+	diagonal[1][1] = -0.5;
+	diagonal[2][2] = 3.0;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	const mv::mat3 operators[] = { mv::mat3(), diagonal, rotated, general };
+	curves::curve_collection collection;
+	for (std::size_t i = 0; i < 12; ++i)
+	{
+		const mv::mat3& op = operators[i % 4];
+		collection.add_circle(1.0 + i, op);
+		collection.add_ellipse(2.0 + i, 0.5 + 0.25 * i, op);
+		collection.add_helix(0.5 + i, 0.1 * i, op);
+	}
+	collection.erase(4);
+	collection.erase(13);
+	collection.erase(35);
+
+	std::vector<curves::curve_id> order;
+	const std::vector<curves::curve_id>* buckets[] = { &collection.circles().id, &collection.ellipses().id,
+		&collection.helices().id };
+	for (const std::vector<curves::curve_id>* ids : buckets)
+		order.insert(order.end(), ids->begin(), ids->end());
+	CHECK(order.size() == collection.size());
+
+	const double grid[] = { 0.0, 0.7, -2.5, 3.14159, 40.0, -1234.5 };
+	const std::size_t n = sizeof(grid) / sizeof(grid[0]);
+	curves::sincos_table table(grid, n), uniform(-3.0, 0.75, 9);
+	std::vector<double> x(collection.size()), y(collection.size()), z(collection.size());
+	for (std::size_t k = 0; k < n; ++k)
+	{
+		double t = grid[k];
+		for (bool derivative : { false, true })
+		{
+			for (std::size_t type = 0; type < 3; ++type)
+			{
+				const std::vector<curves::curve_id>& ids = *buckets[type];
+				if (derivative)
+					collection.get_d_dt_values_at(static_cast<curves::curve_t>(type), t, x.data(), y.data(), z.data());
+				else
+					collection.get_values_at(static_cast<curves::curve_t>(type), t, x.data(), y.data(), z.data());
+				CHECK(_at(collection, ids.data(), ids.size(), t, derivative, x.data(), y.data(), z.data()));
+			}
+			if (derivative)
+				collection.get_d_dt_values_at(t, x.data(), y.data(), z.data());
+			else
+				collection.get_values_at(t, x.data(), y.data(), z.data());
+			CHECK(_at(collection, order.data(), order.size(), t, derivative, x.data(), y.data(), z.data()));
+			if (derivative)
+				collection.get_d_dt_values_at(table, k, x.data(), y.data(), z.data());
+			else
+				collection.get_values_at(table, k, x.data(), y.data(), z.data());
+			CHECK(_at(collection, order.data(), order.size(), t, derivative, x.data(), y.data(), z.data()));
+		}
+	}
+	for (std::size_t k = 0; k < uniform.size(); ++k)
+	{
+		CHECK(uniform.t[k] == -3.0 + 0.75 * static_cast<double>(k));
+		collection.get_values_at(uniform, k, x.data(), y.data(), z.data());
+		CHECK(_at(collection, order.data(), order.size(), uniform.t[k], false, x.data(), y.data(), z.data()));
+		collection.get_d_dt_values_at(uniform, k, x.data(), y.data(), z.data());
+		CHECK(_at(collection, order.data(), order.size(), uniform.t[k], true, x.data(), y.data(), z.data()));
+	}
+}
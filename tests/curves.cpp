@@ -0,0 +1,128 @@
+#include <cmath>
+#include <cfloat>
+#include <memory_resource>
+#include <vector>
+
+#include "check.hpp"
+#include "curves.hpp"
+
+namespace
+{
+	bool _close(const curves::curve_point& p, const curves::curve_point& q)
+	{
+		for (std::size_t j = 0; j < 3; ++j)
+			if (std::abs(p[j] - q[j]) > 4.0 * DBL_EPSILON * (1.0 + std::abs(q[j])))
+				return false;
+		return true;
+	}
+
+	// The variant built from the parameters and from the curve, and the curve allocated from an
+	// arena, against the virtual path; the batch calls share the kernels, so they agree exactly.
+	template <curves::curve_t _type, typename ..._args>
+	bool _same_paths(curves::operator_t expected, const _args&... construct_data)
+	{
+		std::pmr::monotonic_buffer_resource arena;
+		curves::curve_builder::curve_ptr virtual_curve = curves::curve_builder::make_curve<_type>(construct_data...);
+		curves::curve_builder::curve_ptr pmr_curve = curves::curve_builder::allocate_curve<_type>(&arena, construct_data...);
+		const curves::curve_value values[] = { curves::curve_builder::make_value<_type>(construct_data...),
+			curves::curve_builder::make_value(*virtual_curve) };
+		bool same = virtual_curve->get_operator_type() == expected && pmr_curve->get_operator_type() == expected
+			&& pmr_curve->get_type() == _type;
+		const double t[] = { 0.0, 0.5, -1.25, 3.0, 17.0, -250.0, 1e4 };
+		const std::size_t n = sizeof(t) / sizeof(t[0]);
+		double x[n], y[n], z[n], vx[n], vy[n], vz[n];
+		virtual_curve->get_values(t, n, x, y, z);
+		for (const curves::curve_value& value : values)
+		{
+			same = same && value.get_type() == _type;
+			value.get_values(t, n, vx, vy, vz);
+			for (std::size_t i = 0; i < n; ++i)
+				same = same && vx[i] == x[i] && vy[i] == y[i] && vz[i] == z[i];
+			virtual_curve->get_d_dt_values(t, n, x, y, z);
+			value.get_d_dt_values(t, n, vx, vy, vz);
+			for (std::size_t i = 0; i < n; ++i)
+				same = same && vx[i] == x[i] && vy[i] == y[i] && vz[i] == z[i];
+			virtual_curve->get_values(t, n, x, y, z);
+			for (double u : t)
+			{
+				curves::curve_point p = virtual_curve->get_value(u), d = virtual_curve->get_d_dt_value(u), vp, vd;
+				value.get_value_and_derivative(u, vp, vd);
+				same = same && _close(value.get_value(u), p) && _close(value.get_d_dt_value(u), d)
+					&& _close(vp, p) && _close(vd, d) && _close(pmr_curve->get_value(u), p)
+					&& _close(pmr_curve->get_d_dt_value(u), d);
+			}
+		}
+		return same;
+	}
+}
+
+// The bound documented on sample_uniform, against get_value at the same t0 + k * dt:
+// 256 DBL_EPSILON of |a| + |b| for the recurrence, |t| DBL_EPSILON of it for the rounding of t,
+// and the rounding of the sums, which include c t.
+TEST(sample_uniform_drift)
+{
+	mv::mat3 rotated = mv::rotate_euler(mv::vec3(0.3, -1.1, 2.0)), general;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	std::vector<curves::curve_builder::curve_ptr> population = {
+		curves::curve_builder::make_curve<curves::CIRCLE>(10.0),
+		curves::curve_builder::make_curve<curves::ELLIPSE>(12.0, 3.0, rotated),
+		curves::curve_builder::make_curve<curves::HELIX>(10.0, 2.0, rotated),
+		curves::curve_builder::make_curve<curves::HELIX>(4.0, 7.0, general) };
+	const double steps[] = { 1e-4, 1e-2, 0.3, 1.0, 10.0 }, starts[] = { 0.0, -37.0, 1000.0 };
+	const std::size_t n = 1000;
+	std::vector<curves::curve_point> aos(n);
+	std::vector<double> x(n), y(n), z(n);
+	for (const auto& curve : population)
+	{
+		const curves::baked_form& k = curve->get_baked_form();
+		double scale = std::hypot(k.a[0], k.a[1], k.a[2]) + std::hypot(k.b[0], k.b[1], k.b[2]),
+			pitch = std::hypot(k.c[0], k.c[1], k.c[2]);
+		for (double dt : steps)
+			for (double t0 : starts)
+			{
+				curve->sample_uniform(t0, dt, n, aos.data());
+				curve->sample_uniform(t0, dt, n, x.data(), y.data(), z.data());
+				double worst = 0.0;
+				bool same = true;
+				for (std::size_t i = 0; i < n; ++i)
+				{
+					double t = t0 + dt * static_cast<double>(i);
+					double bound = ((256.0 + std::abs(t)) * scale + 2.0 * (scale + pitch * std::abs(t))) * DBL_EPSILON;
+					curves::curve_point p = curve->get_value(t);
+					for (std::size_t j = 0; j < 3; ++j)
+						worst = std::max(worst, std::abs(aos[i][j] - p[j]) / bound);
+					same = same && aos[i][0] == x[i] && aos[i][1] == y[i] && aos[i][2] == z[i];
+				}
+				CHECK(worst <= 1.0);
+				CHECK(same);
+			}
+	}
+}
+
+// One operator of each class through every curve type.
+TEST(curve_paths_agree)
+{
+	mv::mat3 identity, diagonal, rotated = mv::rotate_euler(mv::vec3(0.3, -1.1, 2.0)), general;
+	diagonal[0][0] = 2.0;
+	diagonal[1][1] = -0.5;
+	diagonal[2][2] = 3.0;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	CHECK(curves::classify(identity) == curves::IDENTITY);
+	CHECK(curves::classify(diagonal) == curves::DIAGONAL);
+	CHECK(curves::classify(rotated) == curves::ORTHOGONAL);
+	CHECK(curves::classify(general) == curves::GENERAL);
+
+	const mv::mat3 operators[] = { identity, diagonal, rotated, general };
+	const curves::operator_t types[] = { curves::IDENTITY, curves::DIAGONAL, curves::ORTHOGONAL, curves::GENERAL };
+	for (std::size_t i = 0; i < 4; ++i)
+	{
+		CHECK(_same_paths<curves::CIRCLE>(types[i], 7.0, operators[i]));
+		CHECK(_same_paths<curves::ELLIPSE>(types[i], 12.0, 3.0, operators[i]));
+		CHECK(_same_paths<curves::HELIX>(types[i], 4.0, 1.5, operators[i]));
+	}
+	CHECK(_same_paths<curves::CIRCLE>(curves::IDENTITY, 7.0));
+}
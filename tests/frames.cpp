@@ -0,0 +1,151 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "frames.hpp"
+#include "numeric.hpp"
+
+namespace
+{
+	using curves::numeric::dot;
+
+	double _dot(const curves::curve_point& a, const curves::curve_point& b) { return dot(a.ptr(), b.ptr()); }
+
+	bool _close(double a, double b, double tolerance) { return std::abs(a - b) <= tolerance * (1.0 + std::abs(b)); }
+
+	// Unit axes, mutually orthogonal and right-handed, the tangent along P'.
+	bool _orthonormal(const curves::frame& f, const curves::curve_point& d1)
+	{
+		curves::curve_point b;
+		curves::numeric::cross(f.tangent.ptr(), f.normal.ptr(), &b[0]);
+		bool result = _close(_dot(f.tangent, f.tangent), 1.0, 1e-12) && _close(_dot(f.normal, f.normal), 1.0, 1e-12)
+			&& std::abs(_dot(f.tangent, f.normal)) < 1e-12 && _dot(f.tangent, d1) > 0.0;
+		for (std::size_t i = 0; i < 3; ++i)
+			result = result && std::abs(b[i] - f.binormal[i]) < 1e-12;
+		return result;
+	}
+}
+
+// Frenet frames of rotated and sheared circles, ellipses and helices, one at a time and in
+// batches across several blocks, with the curvature and torsion each way agreeing.
+TEST(frenet_frames_orthonormal)
+{
+	std::mt19937_64 engine(13);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	mv::mat3 general;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	const std::size_t n = 700;
+	std::vector<double> t(n), curvature(n), torsion(n);
+	std::vector<curves::curve_point> points(n);
+	std::vector<curves::frame> frames(n);
+	for (std::size_t i = 0; i < n; ++i)
+		t[i] = -20.0 + 40.0 * static_cast<double>(i) / n;
+	std::size_t failures = 0;
+	for (std::size_t trial = 0; trial < 12; ++trial)
+	{
+		mv::mat3 op = trial % 4 == 3 ? general : mv::rotate_euler(mv::vec3(3.0 * unit(engine), 3.0 * unit(engine), 3.0 * unit(engine)));
+		double R = 1.0 + 9.0 * std::abs(unit(engine));
+		curves::curve_builder::curve_ptr curve = trial % 3 == 0 ? curves::curve_builder::make_curve<curves::CIRCLE>(R, op)
+			: trial % 3 == 1 ? curves::curve_builder::make_curve<curves::ELLIPSE>(R, 0.3 * R, op)
+			: curves::curve_builder::make_curve<curves::HELIX>(R, 4.0 * std::abs(unit(engine)), op);
+		curves::frenet_frames(*curve, t.data(), n, points.data(), frames.data(), curvature.data(), torsion.data());
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			curves::frame f = curves::frenet_frame(*curve, t[i]);
+			curves::curve_point p = curve->get_value(t[i]);
+			failures += !_orthonormal(frames[i], curve->get_d_dt_value(t[i]));
+			failures += !_close(curvature[i], curves::curvature(*curve, t[i]), 1e-12)
+				|| !_close(torsion[i], curves::torsion(*curve, t[i]), 1e-12);
+			for (std::size_t j = 0; j < 3; ++j)
+				failures += std::abs(f.normal[j] - frames[i].normal[j]) > 1e-12 || !_close(points[i][j], p[j], 1e-12);
+		}
+	}
+	CHECK(failures == 0);
+}
+
+// p = (R cos t, R sin t, h t) under any rotation: curvature R / (R^2 + h^2) and torsion
+// h / (R^2 + h^2) everywhere; a circle has 1 / R and none, an ellipse Rx / Ry^2 at t = 0.
+TEST(frenet_helix_curvature_and_torsion)
+{
+	std::mt19937_64 engine(3);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	std::size_t failures = 0;
+	for (std::size_t trial = 0; trial < 20; ++trial)
+	{
+		mv::mat3 op = mv::rotate_euler(mv::vec3(3.0 * unit(engine), 3.0 * unit(engine), 3.0 * unit(engine)));
+		double R = 0.5 + 9.0 * std::abs(unit(engine)), h = 5.0 * std::abs(unit(engine)), t = 30.0 * unit(engine);
+		auto helix = curves::curve_builder::make_curve<curves::HELIX>(R, h, op);
+		auto circle = curves::curve_builder::make_curve<curves::CIRCLE>(R, op);
+		auto ellipse = curves::curve_builder::make_curve<curves::ELLIPSE>(R, 0.4 * R, op);
+		failures += !_close(curves::curvature(*helix, t), R / (R * R + h * h), 1e-12);
+		failures += !_close(curves::torsion(*helix, t), h / (R * R + h * h), 1e-12);
+		failures += !_close(curves::curvature(*circle, t), 1.0 / R, 1e-12);
+		failures += std::abs(curves::torsion(*circle, t)) > 1e-12 / R;
+		failures += !_close(curves::curvature(*ellipse, 0.0), 1.0 / (0.16 * R), 1e-12);
+	}
+	CHECK(failures == 0);
+}
+
+// A helix of radius 0 is a straight line: no curvature or torsion, a zero Frenet normal and
+// binormal, and a transported frame that starts from some unit normal and keeps it.
+TEST(frenet_degenerate_curvature)
+{
+	mv::mat3 op = mv::rotate_euler(mv::vec3(0.3, -1.2, 2.1));
+	auto line = curves::curve_builder::make_curve<curves::HELIX>(0.0, 2.0, op);
+	const double t[] = { -3.0, 0.0, 0.5, 4.0 };
+	curves::frame frenet[4], transported[4];
+	double curvature[4], torsion[4];
+	curves::frenet_frames(*line, t, 4, nullptr, frenet, curvature, torsion);
+	curves::transport_frames(*line, t, 4, nullptr, transported);
+	const curves::curve_point d1 = line->get_d_dt_value(0.0);
+	for (std::size_t i = 0; i < 4; ++i)
+	{
+		CHECK(curvature[i] == 0.0 && torsion[i] == 0.0);
+		CHECK(_dot(frenet[i].normal, frenet[i].normal) == 0.0 && _dot(frenet[i].binormal, frenet[i].binormal) == 0.0);
+		CHECK(_close(_dot(frenet[i].tangent, d1), 2.0, 1e-12));
+		CHECK(_orthonormal(transported[i], d1));
+		for (std::size_t j = 0; j < 3; ++j)
+			CHECK(std::abs(transported[i].normal[j] - transported[0].normal[j]) < 1e-12);
+	}
+}
+
+// On a circle the transported frame never twists away from the Frenet frame: its normal
+// points at the center and its binormal along the axis, over several turns. On a helix it
+// turns against the Frenet frame by the torsion times the arc length.
+TEST(transport_frames_follow_circle)
+{
+	mv::mat3 op = mv::rotate_euler(mv::vec3(-0.7, 0.4, 1.9));
+	const std::size_t n = 2000;
+	std::vector<double> t(n);
+	for (std::size_t i = 0; i < n; ++i)
+		t[i] = 1.0 + 20.0 * static_cast<double>(i) / (n - 1);
+	std::vector<curves::frame> transported(n), frenet(n);
+	auto circle = curves::curve_builder::make_curve<curves::CIRCLE>(3.0, op);
+	curves::transport_frames(*circle, t.data(), n, nullptr, transported.data());
+	curves::frenet_frames(*circle, t.data(), n, nullptr, frenet.data());
+	std::size_t failures = 0;
+	for (std::size_t i = 0; i < n; ++i)
+		failures += !_close(_dot(transported[i].normal, frenet[i].normal), 1.0, 1e-9)
+			|| !_close(_dot(transported[i].binormal, transported[0].binormal), 1.0, 1e-9)
+			|| !_orthonormal(transported[i], circle->get_d_dt_value(t[i]));
+	CHECK(failures == 0);
+
+	const double R = 2.0, h = 0.8, rate = h / std::sqrt(R * R + h * h);
+	auto helix = curves::curve_builder::make_curve<curves::HELIX>(R, h, op);
+	curves::transport_frames(*helix, t.data(), n, nullptr, transported.data());
+	curves::frenet_frames(*helix, t.data(), n, nullptr, frenet.data());
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		double angle = rate * (t[i] - t[0]);
+		curves::curve_point expected;
+		for (std::size_t j = 0; j < 3; ++j)
+			expected[j] = std::cos(angle) * frenet[i].normal[j] - std::sin(angle) * frenet[i].binormal[j];
+		failures += !_close(_dot(transported[i].normal, expected), 1.0, 1e-6)
+			|| !_orthonormal(transported[i], helix->get_d_dt_value(t[i]));
+	}
+	CHECK(failures == 0);
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <exception>
+#include <cstring>
+#include <vector>
+
+#include "check.hpp"
+
+namespace
+{
+	struct _entry
+	{
+		const char* name;
+		tests::function body;
+		bool benchmark;
+	};
+
+	std::vector<_entry>& _entries()
+	{
+		static std::vector<_entry> entries;
+		return entries;
+	}
+
+	std::size_t _failures = 0;
+}
+
+tests::registration::registration(const char* name, function body, bool benchmark)
+{
+	_entries().push_back({ name, body, benchmark });
+}
+
+void tests::fail(const char* file, int line, const char* expression)
+{
+	++_failures;
+	std::cout << file << "(" << line << "): CHECK(" << expression << ") failed" << std::endl;
+}
+
+// tests [--benchmark] [name]: runs the tests, or the benchmarks, whose name contains the filter.
+int main(int argc, char* argv[])
+{
+	bool benchmark = argc > 1 && std::strcmp(argv[1], "--benchmark") == 0;
+	const char* filter = argc > 1 + benchmark ? argv[1 + benchmark] : "";
+	std::size_t run = 0;
+	for (const _entry& e : _entries())
+	{
+		if (e.benchmark != benchmark || std::strstr(e.name, filter) == nullptr)
+			continue;
+		std::size_t before = _failures;
+		std::cout << e.name << std::endl;
+		try
+		{
+			e.body();
+		}
+		catch (const std::exception& error)
+		{
+			tests::fail(e.name, 0, error.what());
+		}
+		if (_failures != before)
+			std::cout << e.name << ": FAILED" << std::endl;
+		++run;
+	}
+	std::cout << run << " run, " << _failures << " failed checks" << std::endl;
+	return _failures == 0 ? 0 : 1;
+}
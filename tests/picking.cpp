@@ -0,0 +1,104 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "picking.hpp"
+
+namespace
+{
+	// Every arc searched on its own, no tree, chord or ring test: the first hit along the ray,
+	// those behind the origin at it.
+	bool _scan(const curves::curve_collection& collection, double t0, double t1, const curves::ray& r,
+		double tolerance, curves::ray_hit& hit)
+	{
+		std::vector<curves::arc> arcs;
+		std::vector<curves::aabb> boxes;
+		curves::split_arcs(collection, t0, t1, curves::arc_tree::default_step, 0.0, arcs, boxes);
+		hit.id = 0;
+		hit.approach.s = HUGE_VAL;
+		hit.approach.distance = HUGE_VAL;
+		for (const curves::arc& part : arcs)
+		{
+			if (!collection.contains(part.id))
+				continue;
+			curves::ray_approach approach = curves::ray_distance(*collection.make_curve(part.id), r, part.t0, part.t1);
+			double x = std::max(approach.s, 0.0), y = std::max(hit.approach.s, 0.0);
+			if (approach.distance <= tolerance && (x < y || (x == y && (approach.distance < hit.approach.distance
+				|| (approach.distance == hit.approach.distance && part.id < hit.id)))))
+			{
+				hit.id = part.id;
+				hit.approach = approach;
+			}
+		}
+		return hit.approach.s != HUGE_VAL;
+	}
+
+	// Random rays through the populated region, picked with the tree and against the scan.
+	std::size_t _mismatches(const curves::curve_collection& collection, const curves::arc_tree& tree, double t0,
+		double t1, std::mt19937_64& engine)
+	{
+		std::uniform_real_distribution<double> coordinate(-40.0, 40.0), unit(-1.0, 1.0), extent(0.05, 2.0);
+		std::size_t mismatches = 0;
+		for (std::size_t trial = 0; trial < 200; ++trial)
+		{
+			curves::ray r;
+			double tolerance = extent(engine);
+			for (std::size_t i = 0; i < 3; ++i)
+			{
+				r.origin[i] = coordinate(engine);
+				r.direction[i] = trial % 7 == 0 && i == trial % 3 ? 0.0 : unit(engine);
+			}
+			curves::ray_hit picked, expected;
+			bool found = curves::pick(collection, tree, r, tolerance, picked);
+			bool scanned = _scan(collection, t0, t1, r, tolerance, expected);
+			if (found != scanned || (found && (picked.id != expected.id
+				|| std::abs(picked.approach.s - expected.approach.s) > 1e-9 * (1.0 + std::abs(expected.approach.s)))))
+				++mismatches;
+		}
+		return mismatches;
+	}
+}
+
+// pick prunes by boxes, chords and rings and stops at the first hit; none of it may change the
+// answer of searching every arc, also once curves the tree still holds are erased.
+TEST(pick_matches_scan)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(300, 23, options);
+	std::mt19937_64 engine(5);
+
+	curves::arc_tree tree(collection, -4.0, 9.0);
+	CHECK(_mismatches(collection, tree, -4.0, 9.0, engine) == 0);
+	for (curves::curve_id id = 0; id < 300; id += 3)
+		collection.erase(id);
+	CHECK(_mismatches(collection, tree, -4.0, 9.0, engine) == 0);
+
+	curves::arc_tree sliver(collection, 1.0, 1.3);
+	CHECK(sliver.arcs().size() == collection.size());
+	CHECK(_mismatches(collection, sliver, 1.0, 1.3, engine) == 0);
+}
+
+// A circle crossed twice by a ray in its plane is hit where the ray meets it first, not where
+// it comes closest.
+TEST(pick_first_crossing)
+{
+	curves::curve_collection collection;
+	collection.add_circle(5.0);
+	curves::arc_tree tree(collection, 0.0, 7.0);
+	curves::ray r;
+	r.origin[0] = -10.0;
+	r.origin[1] = 0.5;
+	r.origin[2] = 0.0;
+	r.direction[0] = 2.0;
+	r.direction[1] = 0.0;
+	r.direction[2] = 0.0;
+	curves::ray_hit hit;
+	CHECK(curves::pick(collection, tree, r, 0.01, hit));
+	CHECK(hit.id == 0);
+	CHECK(std::abs(hit.approach.point[0] + std::sqrt(24.75)) < 1e-6);
+	CHECK(std::abs(hit.approach.s - 0.5 * (10.0 - std::sqrt(24.75))) < 1e-6);
+}
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "check.hpp"
+#include "closest_point.hpp"
+#include "proximity.hpp"
+
+namespace
+{
+	curves::curve_point _point(const curves::baked_form& k, double t)
+	{
+		curves::curve_point p;
+		curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t, p[0], p[1], p[2]);
+		return p;
+	}
+
+	// Smallest distance from dense samples of p, each projected exactly onto q: an upper bound
+	// on the true closest approach that any search has to match.
+	double _sampled(const curves::baked_form& p, const curves::baked_form& q, double t0, double t1)
+	{
+		const std::size_t n = 4000;
+		curves::projector project(q);
+		double best = HUGE_VAL;
+		for (std::size_t i = 0; i <= n; ++i)
+			best = std::min(best, project(_point(p, t0 + (t1 - t0) * static_cast<double>(i) / n), t0, t1).distance);
+		return best;
+	}
+
+	// The approach is a real pair of points and no sampled pair comes closer.
+	bool _closest(const curves::baked_form& p, const curves::baked_form& q, double t0, double t1)
+	{
+		curves::curve_approach approach = curves::closest(p, q, t0, t1);
+		curves::curve_point a = _point(p, approach.s), b = _point(q, approach.t);
+		double reference = std::min(_sampled(p, q, t0, t1), _sampled(q, p, t0, t1));
+		return std::abs(std::hypot(a[0] - b[0], a[1] - b[1], a[2] - b[2]) - approach.distance) <= 1e-9 * (1.0 + approach.distance)
+			&& approach.distance <= reference + 1e-12 * (1.0 + reference);
+	}
+}
+
+// A helix far faster than the pi / 8 sampling step around an ellipse: the closest approach
+// lies between samples, at the end of the range, and has to be found all the same.
+TEST(closest_approach_fast_helix)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(150, 5, options);
+	const curves::baked_form ellipse = collection.make_curve(57)->get_baked_form();
+	const curves::baked_form helix = collection.make_curve(90)->get_baked_form();
+	CHECK(_closest(ellipse, helix, 0.0, 6.0));
+	CHECK(curves::closest(ellipse, helix, 0.0, 6.0).distance < 0.2);
+
+	std::vector<curves::close_pair> pairs;
+	curves::close_pairs(collection, 0.3, 0.0, 6.0, pairs);
+	CHECK(std::any_of(pairs.begin(), pairs.end(), [](const curves::close_pair& pair)
+	{ return pair.first == 57 && pair.second == 90; }));
+}
+
+// Closest approaches of a random population, including helices whose projections jump between
+// branches from one sample to the next, against dense sampling.
+TEST(closest_approach_matches_sampling)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(150, 11, options);
+	CHECK(_closest(collection.make_curve(44)->get_baked_form(), collection.make_curve(141)->get_baked_form(), -9.0, 9.0));
+	std::size_t failures = 0;
+	for (curves::curve_id i = 0; i < 150; i += 7)
+		for (curves::curve_id j = i + 1; j < 150; j += 11)
+			if (!_closest(collection.make_curve(i)->get_baked_form(), collection.make_curve(j)->get_baked_form(), -9.0, 9.0))
+				++failures;
+	CHECK(failures == 0);
+}
+
+// close_pairs against the narrow phase run on every pair of whole curves: the same pairs, the
+// same distances up to the thousandth the search may leave, and approaches that are real pairs
+// of points, over a range within a turn and one beyond it, also with erased curves.
+TEST(close_pairs_match_all_pairs)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(90, 31, options);
+	for (curves::curve_id id : { 3, 40, 77 })
+		collection.erase(id);
+	const double tolerance = 0.4;
+	const double ranges[2][2] = { { 0.5, 4.0 }, { -2.0, 9.0 } };
+	for (const auto& range : ranges)
+	{
+		std::vector<curves::close_pair> pairs;
+		curves::close_pairs(collection, tolerance, range[0], range[1], pairs);
+		CHECK(pairs.size() > 20);
+		std::size_t failures = 0, expected = 0;
+		for (curves::curve_id i = 0; i < 90; ++i)
+			for (curves::curve_id j = i + 1; j < 90; ++j)
+			{
+				if (!collection.contains(i) || !collection.contains(j))
+					continue;
+				const curves::baked_form p = collection.make_curve(i)->get_baked_form(), q = collection.make_curve(j)->get_baked_form();
+				double distance = curves::closest(p, q, range[0], range[1]).distance;
+				auto found = std::find_if(pairs.begin(), pairs.end(), [i, j](const curves::close_pair& pair)
+				{ return pair.first == i && pair.second == j; });
+				if (found == pairs.end())
+				{
+					failures += distance <= 0.999 * tolerance;
+					continue;
+				}
+				++expected;
+				const curves::curve_approach& approach = found->approach;
+				curves::curve_point a = _point(p, approach.s), b = _point(q, approach.t);
+				failures += approach.distance > tolerance || distance > 1.001 * tolerance
+					|| std::abs(approach.distance - distance) > 1e-3 * distance + 1e-9
+					|| std::abs(std::hypot(a[0] - b[0], a[1] - b[1], a[2] - b[2]) - approach.distance) > 1e-9 * (1.0 + approach.distance)
+					|| approach.s < range[0] - 1e-12 || approach.t < range[0] - 1e-12
+					|| approach.s > range[1] + 1e-12 || approach.t > range[1] + 1e-12;
+			}
+		CHECK(failures == 0);
+		CHECK(expected == pairs.size());
+		CHECK(std::is_sorted(pairs.begin(), pairs.end(), [](const curves::close_pair& x, const curves::close_pair& y)
+		{ return x.first < y.first || (x.first == y.first && x.second < y.second); }));
+	}
+}
@@ -0,0 +1,67 @@
+#include <cstring>
+#include <vector>
+
+#include "check.hpp"
+#include "collection.hpp"
+
+namespace
+{
+	template <typename _type>
+	bool _same(const std::vector<_type>& a, const std::vector<_type>& b)
+	{ return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(_type)) == 0); }
+
+	bool _same(const curves::curve_collection& a, const curves::curve_collection& b)
+	{
+		return _same(a.circles().R, b.circles().R) && _same(a.circles().baked, b.circles().baked)
+			&& _same(a.circles().id, b.circles().id)
+			&& _same(a.ellipses().Rx, b.ellipses().Rx) && _same(a.ellipses().Ry, b.ellipses().Ry)
+			&& _same(a.ellipses().baked, b.ellipses().baked) && _same(a.ellipses().id, b.ellipses().id)
+			&& _same(a.helices().R, b.helices().R) && _same(a.helices().h, b.helices().h)
+			&& _same(a.helices().baked, b.helices().baked) && _same(a.helices().id, b.helices().id);
+	}
+
+	bool _same(const curves::baked_form& a, const curves::baked_form& b)
+	{ return std::memcmp(&a, &b, sizeof(a)) == 0; }
+}
+
+// A seed fixes the population: the same on any thread count, split over several calls or
+// drawn one curve at a time, and different for another seed.
+TEST(random_seed_reproducibility)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	const std::size_t count = 20000;
+	const int before = curves::reduce::threads();
+
+	tests::set_threads(1);
+	curves::curve_collection reference;
+	reference.add_random(count, 42, options);
+	for (int threads : { 2, 3, 8 })
+	{
+		tests::set_threads(threads);
+		curves::curve_collection other;
+		other.add_random(count, 42, options);
+		CHECK(_same(other, reference));
+	}
+	tests::set_threads(before);
+
+	bool matches = true;
+	for (curves::curve_id id = 0; id < count; id += 97)
+	{
+		curves::curve_builder::curve_ptr curve = curves::make_random_curve(42, id, options);
+		matches = matches && curve->get_type() == reference.find(id).type
+			&& _same(curve->get_baked_form(), reference.make_curve(id)->get_baked_form());
+	}
+	CHECK(matches);
+
+	// a second call continues the ids and draws its own sequence from index 0
+	curves::curve_collection appended;
+	appended.add_random(1000, 42, options);
+	appended.add_random(1000, 43, options);
+	CHECK(appended.size() == 2000);
+	CHECK(_same(appended.make_curve(1500)->get_baked_form(), curves::make_random_curve(43, 500, options)->get_baked_form()));
+
+	curves::curve_collection reseeded;
+	reseeded.add_random(count, 41, options);
+	CHECK(!_same(reseeded, reference));
+}
@@ -0,0 +1,54 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "collection.hpp"
+
+namespace
+{
+	bool _same_bits(const curves::reduce::statistics& a, const curves::reduce::statistics& b)
+	{
+		return std::memcmp(&a.sum, &b.sum, sizeof(double)) == 0 && a.min == b.min && a.max == b.max
+			&& a.count == b.count;
+	}
+}
+
+// DETERMINISTIC gives the same bits on any thread count, including counts that leave the
+// last block short and values spread over many orders of magnitude.
+TEST(reduce_deterministic_across_thread_counts)
+{
+	std::mt19937_64 engine(13);
+	std::uniform_real_distribution<double> exponent(-8.0, 16.0), sign(-1.0, 1.0);
+	std::vector<double> values(100003);
+	for (double& v : values)
+		v = std::copysign(std::pow(10.0, exponent(engine)), sign(engine));
+
+	const int before = curves::reduce::threads();
+	const std::size_t counts[] = { 0, 1, curves::reduce::block - 1, curves::reduce::block + 1, values.size() };
+	for (std::size_t count : counts)
+	{
+		tests::set_threads(1);
+		curves::reduce::statistics reference = curves::reduce::run(values.data(), count, curves::reduce::DETERMINISTIC);
+		for (int threads : { 2, 3, 4, 7, 8, 16 })
+		{
+			tests::set_threads(threads);
+			CHECK(_same_bits(curves::reduce::run(values.data(), count, curves::reduce::DETERMINISTIC), reference));
+		}
+	}
+
+	curves::curve_collection collection;
+	curves::random_options options;
+	options.radius = { 1e-3, 1e6 };
+	collection.add_random(50000, 7, options);
+	tests::set_threads(1);
+	curves::reduce::statistics radii = curves::aggregate(collection, curves::CIRCLE, curves::RADIUS, curves::reduce::DETERMINISTIC),
+		steps = curves::aggregate(collection, curves::HELIX, curves::STEP, curves::reduce::DETERMINISTIC);
+	for (int threads : { 2, 5, 8 })
+	{
+		tests::set_threads(threads);
+		CHECK(_same_bits(curves::aggregate(collection, curves::CIRCLE, curves::RADIUS, curves::reduce::DETERMINISTIC), radii));
+		CHECK(_same_bits(curves::aggregate(collection, curves::HELIX, curves::STEP, curves::reduce::DETERMINISTIC), steps));
+	}
+	tests::set_threads(before);
+}
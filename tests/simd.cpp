@@ -0,0 +1,131 @@
+#include <cmath>
+#include <string>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "simd.hpp"
+
+namespace
+{
+	// tolerance * (|a| + |b| + |c * t|) on every component, against std::cos and std::sin
+	bool _agrees(const curves::baked_form& k, double t, const double* p, const double* d)
+	{
+		double c = std::cos(t), s = std::sin(t);
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			double bound = curves::simd::tolerance * (std::abs(k.a[j]) + std::abs(k.b[j]) + std::abs(k.c[j] * t));
+			double value = k.a[j] * c + k.b[j] * s + k.c[j] * t, derivative = k.b[j] * c - k.a[j] * s + k.c[j];
+			if (std::isnan(value) != std::isnan(p[j]) || std::isnan(derivative) != std::isnan(d[j]))
+				return false;
+			if (!std::isnan(value) && (std::abs(p[j] - value) > bound || std::abs(d[j] - derivative) > bound + curves::simd::tolerance * std::abs(k.c[j])))
+				return false;
+		}
+		return true;
+	}
+
+	// Runs check under every instruction set the processor takes, then restores the one in use.
+	template <typename _check>
+	void _each_instruction_set(const _check& check)
+	{
+		const std::string selected = curves::simd::instruction_set();
+		for (const char* name : { "avx512", "avx2", "sse2", "scalar" })
+			if (curves::simd::use_instruction_set(name))
+			{
+				CHECK(curves::simd::instruction_set() == std::string(name));
+				check();
+			}
+		CHECK(curves::simd::use_instruction_set(selected.c_str()));
+	}
+
+	// Counts up to three packs of eight and the starting offsets reach both the packs and the
+	// scalar tail.
+	void _matches_scalar_path()
+	{
+		std::mt19937_64 engine(3);
+		std::uniform_real_distribution<double> unit(-1.0, 1.0);
+		std::uniform_real_distribution<double> exponent(-6.0, 6.0);
+		std::vector<double> t(1 << 14);
+		for (std::size_t i = 0; i < t.size(); ++i)
+			t[i] = std::copysign(std::pow(10.0, exponent(engine)), unit(engine));
+		// quadrant boundaries and the documented end of the range
+		const double edges[] = { 0.0, -0.0, 0.78539816339744830962, 1.57079632679489661923,
+			3.14159265358979323846, 4.71238898038468985769, 1e6, -1e6 };
+		for (std::size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); ++i)
+			t[i] = edges[i];
+
+		for (std::size_t trial = 0; trial < 8; ++trial)
+		{
+			curves::baked_form k;
+			for (std::size_t j = 0; j < 3; ++j)
+			{
+				k.a[j] = 10.0 * unit(engine);
+				k.b[j] = 10.0 * unit(engine);
+				k.c[j] = unit(engine);
+			}
+			std::vector<double> x(t.size()), y(t.size()), z(t.size()), dx(t.size()), dy(t.size()), dz(t.size());
+			curves::simd::get_value_and_derivative(k, t.data(), t.size(), x.data(), y.data(), z.data(),
+				dx.data(), dy.data(), dz.data());
+			std::size_t bad = 0;
+			for (std::size_t i = 0; i < t.size(); ++i)
+			{
+				double p[3] = { x[i], y[i], z[i] }, d[3] = { dx[i], dy[i], dz[i] };
+				bad += !_agrees(k, t[i], p, d);
+			}
+			CHECK(bad == 0);
+
+			for (std::size_t count = 0; count <= 27; ++count)
+				for (std::size_t offset = 0; offset < 3; ++offset)
+				{
+					curves::simd::get_values(k, t.data() + offset, count, x.data(), y.data(), z.data());
+					curves::simd::get_d_dt_values(k, t.data() + offset, count, dx.data(), dy.data(), dz.data());
+					for (std::size_t i = 0; i < count; ++i)
+					{
+						double p[3] = { x[i], y[i], z[i] }, d[3] = { dx[i], dy[i], dz[i] };
+						bad += !_agrees(k, t[offset + i], p, d);
+					}
+				}
+			CHECK(bad == 0);
+		}
+	}
+
+	void _sincos_out_of_range()
+	{
+		const double nan = std::numeric_limits<double>::quiet_NaN(), inf = std::numeric_limits<double>::infinity();
+		// every position of an out-of-range parameter within a pack of eight and in the tail
+		const double wide[] = { 1e300, -3e7, 1.0000001e6, inf, -inf, nan };
+		for (double w : wide)
+			for (std::size_t at = 0; at < 11; ++at)
+			{
+				std::vector<double> t(11), s(11), c(11);
+				for (std::size_t i = 0; i < t.size(); ++i)
+					t[i] = i == at ? w : 0.25 * i;
+				curves::simd::sincos(t.data(), t.size(), s.data(), c.data());
+				for (std::size_t i = 0; i < t.size(); ++i)
+				{
+					double es = std::sin(t[i]), ec = std::cos(t[i]);
+					if (std::isnan(es))
+						CHECK(std::isnan(s[i]) && std::isnan(c[i]));
+					else
+						CHECK(std::abs(s[i] - es) <= curves::simd::tolerance && std::abs(c[i] - ec) <= curves::simd::tolerance);
+				}
+			}
+	}
+}
+
+// Every kernel built into the library and run by the processor, not only the one cpuid picked.
+TEST(simd_matches_scalar_path)
+{ _each_instruction_set(_matches_scalar_path); }
+
+TEST(simd_sincos_out_of_range)
+{ _each_instruction_set(_sincos_out_of_range); }
+
+TEST(simd_instruction_set_selection)
+{
+	const std::string selected = curves::simd::instruction_set();
+	CHECK(!curves::simd::use_instruction_set("avx1024"));
+	CHECK(curves::simd::instruction_set() == selected);
+	CHECK(curves::simd::use_instruction_set("scalar"));
+	CHECK(curves::simd::use_instruction_set(selected.c_str()));
+}
@@ -0,0 +1,232 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "slicing.hpp"
+#include "reduce.hpp"
+#include "numeric.hpp"
+
+namespace
+{
+	double _height(const curves::baked_form& k, const curves::plane& p, double t)
+	{
+		double x, y, z;
+		curves::combine(curves::GENERAL, k, std::cos(t), std::sin(t), t, x, y, z);
+		return p.normal[0] * x + p.normal[1] * y + p.normal[2] * z - p.offset;
+	}
+
+	// Sign changes of n.P - offset over 200001 samples of [t0, t1], each bisected down to rounding.
+	std::vector<double> _scan(const curves::baked_form& k, const curves::plane& p, double t0, double t1)
+	{
+		const std::size_t n = 200000;
+		std::vector<double> roots;
+		double h = (t1 - t0) / n, previous = _height(k, p, t0);
+		for (std::size_t i = 1; i <= n; ++i)
+		{
+			double u = t0 + h * (i - 1.0), v = i == n ? t1 : t0 + h * static_cast<double>(i), current = _height(k, p, v);
+			if ((previous < 0.0) != (current < 0.0))
+			{
+				double lo = u, hi = v, flo = previous;
+				for (std::size_t step = 0; step < 100 && hi - lo > 0.0; ++step)
+				{
+					double middle = 0.5 * (lo + hi), fm = _height(k, p, middle);
+					if (middle <= lo || middle >= hi)
+						break;
+					if ((fm < 0.0) == (flo < 0.0))
+					{
+						lo = middle;
+						flo = fm;
+					}
+					else
+						hi = middle;
+				}
+				roots.push_back(0.5 * (lo + hi));
+			}
+			previous = current;
+		}
+		return roots;
+	}
+
+	// Same count, and every root within what the height can resolve: 1e-12 of its scale over the slope.
+	bool _same_roots(const curves::baked_form& k, const curves::plane& p, double t0, double t1)
+	{
+		std::vector<double> found, expected = _scan(k, p, t0, t1);
+		curves::intersect(k, p, t0, t1, found);
+		if (found.size() != expected.size() || !std::is_sorted(found.begin(), found.end()))
+			return false;
+		double scale = 0.0;
+		for (std::size_t j = 0; j < 3; ++j)
+			scale += std::abs(p.normal[j]) * (std::abs(k.a[j]) + std::abs(k.b[j]) + std::abs(k.c[j]) * (1.0 + std::abs(t0) + std::abs(t1)));
+		for (std::size_t i = 0; i < found.size(); ++i)
+		{
+			double slope = std::abs(_height(k, p, found[i] + 1e-7) - _height(k, p, found[i] - 1e-7)) / 2e-7;
+			if (std::abs(found[i] - expected[i]) > 1e-11 * (scale + std::abs(p.offset)) / std::max(slope, 1e-3)
+				|| std::abs(_height(k, p, found[i])) > 1e-12 * (scale + std::abs(p.offset)))
+				return false;
+		}
+		return true;
+	}
+
+	curves::plane _plane(std::mt19937_64& engine, double spread)
+	{
+		std::uniform_real_distribution<double> unit(-1.0, 1.0);
+		curves::plane p;
+		for (std::size_t j = 0; j < 3; ++j)
+			p.normal[j] = 2.0 * unit(engine);
+		p.offset = spread * unit(engine);
+		return p;
+	}
+}
+
+// Circles and ellipses (C == 0, the acos form), helices across the plane (Newton on the
+// monotone pieces) and along it (C == 0 again), under rotated and sheared operators.
+TEST(intersect_matches_sign_changes)
+{
+	std::mt19937_64 engine(41);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	mv::mat3 general;
+	general[0][1] = 0.4;
+	general[1][2] = -2.5;
+	general[2][0] = 0.7;
+	std::size_t failures = 0;
+	for (std::size_t trial = 0; trial < 60; ++trial)
+	{
+		mv::mat3 op = trial % 3 == 2 ? general : mv::rotate_euler(mv::vec3(3.0 * unit(engine), 3.0 * unit(engine), 3.0 * unit(engine)));
+		double R = 1.0 + 5.0 * std::abs(unit(engine));
+		double t0 = 10.0 * unit(engine), t1 = t0 + 25.0 * std::abs(unit(engine));
+		const curves::baked_form forms[] = { curves::bake(op, R, R, 0.0), curves::bake(op, R, 0.2 * R, 0.0),
+			curves::bake(op, R, R, 0.05 * R), curves::bake(op, R, R, 2.0 * R) };
+		for (const curves::baked_form& k : forms)
+		{
+			curves::plane p = _plane(engine, 2.0 * R);
+			failures += !_same_roots(k, p, t0, t1);
+			if (k.c[0] == 0.0 && k.c[1] == 0.0 && k.c[2] == 0.0)
+				continue;
+			// normal orthogonal to the axis: the helix runs along the plane and f has C == 0
+			double w[3] = { unit(engine), unit(engine), unit(engine) };
+			double along = curves::numeric::dot(w, k.c) / curves::numeric::dot(k.c, k.c);
+			for (std::size_t j = 0; j < 3; ++j)
+				p.normal[j] = w[j] - along * k.c[j];
+			failures += !_same_roots(k, p, t0, t1);
+		}
+	}
+	CHECK(failures == 0);
+}
+
+// A plane touching a circle counts once, also where the touch is the boundary between pieces or
+// the start of the range; a plane through the start of the range finds it once.
+TEST(intersect_tangent_and_end_contacts)
+{
+	curves::baked_form k = curves::bake(mv::mat3(), 2.0, 2.0, 0.0);
+	curves::plane p = { { 1.0, 0.0, 0.0 }, 2.0 };
+	std::vector<double> t;
+	curves::intersect(k, p, -1.0, 1.0, t);
+	CHECK(t.size() == 1 && std::abs(t[0]) < 1e-7);
+	curves::intersect(k, p, -1.0, 2.0 * curves::numeric::two_pi - 1.0, t);
+	CHECK(t.size() == 2 && std::abs(t[1] - curves::numeric::two_pi) < 1e-7);
+	curves::intersect(k, p, 0.0, 1.0, t);
+	CHECK(t.size() == 1 && t[0] == 0.0);
+
+	p.offset = 2.0 * std::cos(0.5);
+	curves::intersect(k, p, 0.5, 2.0, t);
+	CHECK(t.size() == 1 && std::abs(t[0] - 0.5) < 1e-12);
+	curves::intersect(k, p, -0.5, 0.5, t);
+	CHECK(t.size() == 2 && std::abs(t[0] + 0.5) < 1e-12 && std::abs(t[1] - 0.5) < 1e-12);
+
+	// the curve in the plane has no isolated roots
+	curves::plane flat = { { 0.0, 0.0, 1.0 }, 0.0 };
+	curves::intersect(k, flat, 0.0, 10.0, t);
+	CHECK(t.empty());
+}
+
+// Every plane of slice holds, curve by curve, exactly what intersect finds for that curve, at
+// the same parameters and points, on any number of threads and for both overloads.
+TEST(slice_matches_intersect)
+{
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	curves::curve_collection collection;
+	collection.add_random(300, 12, options);
+	collection.erase(7);
+	collection.erase(150);
+	std::vector<curves::curve_id> order;
+	std::vector<curves::curve_builder::curve_ptr> curves_;
+	for (const std::vector<curves::curve_id>* ids : { &collection.circles().id, &collection.ellipses().id, &collection.helices().id })
+		for (curves::curve_id id : *ids)
+		{
+			order.push_back(id);
+			curves_.push_back(collection.make_curve(id));
+		}
+
+	const double normal[3] = { 0.3, -0.2, 0.9 };
+	std::vector<double> offsets;
+	for (double d = -60.0; d <= 60.0; d += 2.5)
+		offsets.push_back(d);
+	offsets.insert(offsets.begin() + 10, offsets[10]);
+	const double t0 = -3.0, t1 = 8.0;
+
+	curves::sections expected;
+	expected.offsets.push_back(0);
+	std::vector<double> roots;
+	for (double d : offsets)
+	{
+		curves::plane p = { { normal[0], normal[1], normal[2] }, d };
+		for (std::size_t i = 0; i < order.size(); ++i)
+		{
+			curves::intersect(*curves_[i], p, t0, t1, roots);
+			for (double t : roots)
+			{
+				expected.id.push_back(order[i]);
+				expected.t.push_back(t);
+				expected.points.push_back(curves_[i]->get_value(t));
+			}
+		}
+		expected.offsets.push_back(expected.t.size());
+	}
+	CHECK(expected.t.size() > 1000);
+
+	const int before = curves::reduce::threads();
+	for (int threads : { 1, 4 })
+	{
+		tests::set_threads(threads);
+		curves::sections from_collection, from_array;
+		curves::slice(collection, normal, offsets.data(), offsets.size(), t0, t1, from_collection);
+		curves::slice(curves_.data(), curves_.size(), normal, offsets.data(), offsets.size(), t0, t1, from_array);
+		CHECK(from_collection.offsets == expected.offsets && from_array.offsets == expected.offsets);
+		CHECK(from_collection.id == expected.id && from_array.t == from_collection.t);
+		if (from_collection.t.size() != expected.t.size() || from_array.id.size() != expected.id.size())
+			continue;
+		std::size_t mismatches = 0;
+		for (std::size_t row = 0; row < expected.t.size(); ++row)
+		{
+			mismatches += from_array.id[row] != static_cast<curves::curve_id>(
+				std::find(order.begin(), order.end(), expected.id[row]) - order.begin());
+			mismatches += std::abs(from_collection.t[row] - expected.t[row]) > 1e-10 * (1.0 + std::abs(expected.t[row]));
+			for (std::size_t j = 0; j < 3; ++j)
+				mismatches += std::abs(from_collection.points[row][j] - expected.points[row][j]) > 1e-9 * (1.0 + std::abs(expected.points[row][j]))
+					|| from_array.points[row][j] != from_collection.points[row][j];
+		}
+		CHECK(mismatches == 0);
+	}
+	tests::set_threads(before);
+}
+
+TEST(slice_rejects_unsorted_offsets)
+{
+	curves::curve_collection collection;
+	collection.add_circle(1.0);
+	const double normal[3] = { 1.0, 0.0, 0.0 }, offsets[] = { 0.0, 0.5, 0.25 };
+	curves::sections result;
+	bool thrown = false;
+	try
+	{
+		curves::slice(collection, normal, offsets, 3, 0.0, 1.0, result);
+	}
+	catch (const curves::curve_builder::build_exception&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+}
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "check.hpp"
+#include "storage.hpp"
+
+namespace
+{
+	const char* const _path = "storage_test.curves";
+
+	bool _rejects(const char* path)
+	{
+		try
+		{
+			curves::mapped_collection(path).load();
+		}
+		catch (const curves::storage_exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	// rewrites the header, then record index of the circle section, through the patches
+	template <typename _header_patch, typename _record_patch>
+	void _patch(const _header_patch& patch_header, std::size_t index, const _record_patch& patch_record)
+	{
+		std::vector<char> bytes;
+		{
+			std::ifstream in(_path, std::ios::binary);
+			bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+		curves::storage::file_header header;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		char* at = bytes.data() + header.offset[curves::CIRCLE] + index * sizeof(curves::storage::record);
+		patch_header(header);
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		curves::storage::record r;
+		std::memcpy(&r, at, sizeof(r));
+		patch_record(r);
+		std::memcpy(at, &r, sizeof(r));
+		std::ofstream(_path, std::ios::binary | std::ios::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	template <typename _record_patch>
+	void _patch_record(std::size_t index, const _record_patch& patch)
+	{ _patch([](curves::storage::file_header&) {}, index, patch); }
+
+	template <typename _header_patch>
+	void _patch_header(const _header_patch& patch)
+	{ _patch(patch, 0, [](curves::storage::record&) {}); }
+}
+
+// Identifiers survive a round trip, erased ones included: nothing is renumbered and the next
+// insertion does not reuse an id the saved collection had handed out.
+TEST(storage_round_trip_keeps_identifiers)
+{
+	curves::curve_collection collection;
+	curves::random_options options;
+	options.operator_probability = 0.5;
+	collection.add_random(1000, 5, options);
+	const curves::curve_id erased[] = { 3, 500, 998, 999 };
+	collection.erase(erased, 4);
+	curves::save(collection, _path);
+
+	curves::curve_collection loaded = curves::mapped_collection(_path).load();
+	CHECK(loaded.size() == collection.size());
+	CHECK(loaded.next_id() == 1000);
+	bool same = true;
+	for (curves::curve_id id = 0; id < 1000; ++id)
+	{
+		same = same && loaded.contains(id) == collection.contains(id);
+		if (collection.contains(id))
+			same = same && loaded.find(id).type == collection.find(id).type
+				&& std::memcmp(&loaded.make_curve(id)->get_baked_form(), &collection.make_curve(id)->get_baked_form(),
+					sizeof(curves::baked_form)) == 0;
+	}
+	CHECK(same);
+	CHECK(loaded.add_circle(1.0) == 1000);
+	CHECK(collection.add_circle(1.0) == 1000);
+
+	curves::curve_collection empty;
+	empty.add_circle(1.0);
+	empty.erase(0);
+	curves::save(empty, _path);
+	curves::curve_collection reloaded = curves::mapped_collection(_path).load();
+	CHECK(reloaded.size() == 0 && reloaded.add_helix(1.0, 1.0) == 1);
+	std::remove(_path);
+}
+
+TEST(storage_load_rejects_corrupt_records)
+{
+	curves::curve_collection collection;
+	for (int i = 0; i < 4; ++i)
+		collection.add_circle(1.0 + i);
+
+	curves::save(collection, _path);
+	_patch_record(2, [](curves::storage::record& r) { r.id = 1; });
+	CHECK(_rejects(_path));
+
+	curves::save(collection, _path);
+	_patch_record(0, [](curves::storage::record& r) { r.op_type = curves::GENERAL + 1; });
+	CHECK(_rejects(_path));
+
+	curves::save(collection, _path);
+	_patch_record(3, [](curves::storage::record& r) { r.id = 4; });
+	CHECK(_rejects(_path));
+
+	// next_id below the record count, or beyond what any slot table can hold
+	curves::save(collection, _path);
+	_patch_header([](curves::storage::file_header& h) { h.next_id = 3; });
+	CHECK(_rejects(_path));
+
+	curves::save(collection, _path);
+	_patch_header([](curves::storage::file_header& h) { h.next_id = std::uint64_t(1) << 60; });
+	CHECK(_rejects(_path));
+
+	// radii the collection itself would refuse
+	curves::save(collection, _path);
+	_patch_record(1, [](curves::storage::record& r) { r.p0 = -1.0; });
+	CHECK(_rejects(_path));
+
+	curves::save(collection, _path);
+	_patch_record(2, [](curves::storage::record& r) { r.p0 = HUGE_VAL; });
+	CHECK(_rejects(_path));
+
+	curves::save(collection, _path);
+	_patch_record(3, [](curves::storage::record& r) { r.p0 = std::nan(""); });
+	CHECK(_rejects(_path));
+
+	curves::save(collection, _path);
+	CHECK(!_rejects(_path));
+	std::remove(_path);
+}
+
+// Erased identifiers may outnumber the bytes of the file that save writes; it still loads.
+TEST(storage_loads_mostly_erased_collection)
+{
+	curves::curve_collection collection;
+	for (int i = 0; i < 1000; ++i)
+		collection.add_circle(1.0 + i);
+	for (curves::curve_id id = 0; id < 999; ++id)
+		collection.erase(id);
+	curves::save(collection, _path);
+	CHECK(!_rejects(_path));
+	curves::curve_collection loaded = curves::mapped_collection(_path).load();
+	CHECK(loaded.size() == 1 && loaded.contains(999) && !loaded.contains(998) && loaded.next_id() == 1000);
+	CHECK(loaded.make_curve(999)->get_value(0.0)[0] == 1000.0);
+	std::remove(_path);
+}
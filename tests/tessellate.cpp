@@ -0,0 +1,83 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "check.hpp"
+#include "tessellate.hpp"
+
+namespace
+{
+	double _distance(const curves::curve_point& p, const curves::curve_point& a, const curves::curve_point& b)
+	{
+		double ab[3], ap[3];
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			ab[j] = b[j] - a[j];
+			ap[j] = p[j] - a[j];
+		}
+		double length2 = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+		double u = length2 > 0.0 ? std::clamp((ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2]) / length2, 0.0, 1.0) : 0.0;
+		return std::hypot(ap[0] - u * ab[0], ap[1] - u * ab[1], ap[2] - u * ab[2]);
+	}
+
+	// Largest distance between the curve, sampled densely over every segment, and that segment.
+	double _deviation(const curves::interface_curve& curve, const curves::polyline& line)
+	{
+		double worst = 0.0;
+		for (std::size_t i = 0; i + 1 < line.t.size(); ++i)
+			for (std::size_t k = 1; k < 64; ++k)
+			{
+				double t = line.t[i] + (line.t[i + 1] - line.t[i]) * static_cast<double>(k) / 64.0;
+				worst = std::max(worst, _distance(curve.get_value(t), line.points[i], line.points[i + 1]));
+			}
+		return worst;
+	}
+}
+
+// Curves with zero curvature, a straight ellipse and circles squashed flat by singular
+// operators, still sweep back and forth; the polyline has to follow them.
+TEST(tessellate_follows_flat_curves)
+{
+	mv::mat3 squash, shear;
+	squash[1][1] = 0.0;
+	shear[0][2] = 1.0;
+	shear[1][1] = 0.0;
+	shear[1][2] = 0.0;
+	shear[2][2] = 0.0;
+	const double pi = 3.14159265358979323846;
+	curves::tessellation_options options;
+	std::vector<curves::curve_builder::curve_ptr> population = {
+		curves::curve_builder::make_curve<curves::ELLIPSE>(2.0, 0.0),
+		curves::curve_builder::make_curve<curves::CIRCLE>(3.0, squash),
+		curves::curve_builder::make_curve<curves::HELIX>(2.0, 1.9, shear) };
+	curves::polyline line;
+	for (const auto& curve : population)
+	{
+		curves::tessellate(*curve, -0.5 * pi, 1.5 * pi, options, line);
+		CHECK(line.t.size() > 2);
+		CHECK(_deviation(*curve, line) <= options.chord);
+	}
+}
+
+// The midpoint and turn tests bound the deviation of ordinary curves as well.
+TEST(tessellate_chord_bound)
+{
+	std::mt19937_64 engine(17);
+	std::uniform_real_distribution<double> entry(-1.0, 1.0), radius(0.5, 20.0);
+	curves::tessellation_options options;
+	curves::polyline line;
+	double worst = 0.0;
+	for (std::size_t trial = 0; trial < 60; ++trial)
+	{
+		mv::mat3 m;
+		for (auto e = m.begin(); e != m.end(); ++e)
+			*e = entry(engine);
+		curves::curve_builder::curve_ptr curve = trial % 3 == 0 ? curves::curve_builder::make_curve<curves::CIRCLE>(radius(engine), m)
+			: trial % 3 == 1 ? curves::curve_builder::make_curve<curves::ELLIPSE>(radius(engine), radius(engine), m)
+			: curves::curve_builder::make_curve<curves::HELIX>(radius(engine), radius(engine), m);
+		curves::tessellate(*curve, -4.0, 9.0, options, line);
+		worst = std::max(worst, _deviation(*curve, line));
+	}
+	CHECK(worst <= options.chord);
+}
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "reduce.hpp"
+#include "writer.hpp"
+
+namespace
+{
+	const char* const _serial = "writer_test_serial.csv";
+	const char* const _parallel = "writer_test_parallel.csv";
+
+	std::string _read(const char* path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	// Every value the file holds, in order, parsed back by strtod; false on a malformed row.
+	bool _parse(const std::string& text, std::size_t columns, std::vector<double>& values)
+	{
+		values.clear();
+		const char* at = text.c_str();
+		const char* end = at + text.size();
+		while (at < end)
+			for (std::size_t c = 0; c < columns; ++c)
+			{
+				char* next;
+				values.push_back(std::strtod(at, &next));
+				if (next == at || *next != (c + 1 < columns ? ',' : '\n'))
+					return false;
+				at = next + 1;
+			}
+		return true;
+	}
+
+	bool _same_bits(const std::vector<double>& a, const std::vector<double>& b)
+	{ return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0; }
+
+	// Random finite bit patterns across the whole exponent range, with the edge cases first.
+	std::vector<double> _values(std::size_t count, std::uint64_t seed)
+	{
+		std::vector<double> result = { 0.0, -0.0, 0.1, 1.0 / 3.0, -2.2250738585072014e-308,
+			std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max(),
+			std::numeric_limits<double>::lowest(), 1e23, 5e-324 * 3.0 };
+		std::mt19937_64 engine(seed);
+		while (result.size() < count)
+		{
+			std::uint64_t bits = engine();
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			if (std::isfinite(value))
+				result.push_back(engine() % 2 ? value : static_cast<double>(static_cast<std::int64_t>(bits) >> 20) * 1e-6);
+		}
+		result.resize(count);
+		return result;
+	}
+}
+
+// More blocks of rows than threads, so the parallel path takes several waves; a small writer buffer
+// so that rows straddle flushes.
+TEST(write_csv_parallel_matches_serial_and_round_trips)
+{
+	const std::size_t count = 3 * 16384 + 123;
+	std::vector<double> t = _values(count, 1), x = _values(count, 2), y = _values(count, 3), z = _values(count, 4);
+	std::vector<curves::curve_point> points(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		points[i][0] = x[i];
+		points[i][1] = y[i];
+		points[i][2] = z[i];
+	}
+	const int before = curves::reduce::threads();
+	tests::set_threads(4);
+
+	{
+		curves::text_writer serial(_serial, 1000);
+		curves::write_csv(serial, t.data(), x.data(), y.data(), z.data(), count, false);
+		curves::text_writer parallel(_parallel);
+		curves::write_csv(parallel, t.data(), x.data(), y.data(), z.data(), count, true);
+	}
+	std::string text = _read(_serial);
+	CHECK(!text.empty() && text == _read(_parallel));
+	std::vector<double> parsed, expected;
+	for (std::size_t i = 0; i < count; ++i)
+		expected.insert(expected.end(), { t[i], x[i], y[i], z[i] });
+	CHECK(_parse(text, 4, parsed) && _same_bits(parsed, expected));
+
+	{
+		curves::text_writer serial(_serial, 1000);
+		curves::write_csv(serial, points.data(), count, false);
+		curves::text_writer parallel(_parallel);
+		curves::write_csv(parallel, points.data(), count, true);
+	}
+	text = _read(_serial);
+	CHECK(!text.empty() && text == _read(_parallel));
+	expected.clear();
+	for (std::size_t i = 0; i < count; ++i)
+		expected.insert(expected.end(), { x[i], y[i], z[i] });
+	CHECK(_parse(text, 3, parsed) && _same_bits(parsed, expected));
+
+	tests::set_threads(before);
+	std::remove(_serial);
+	std::remove(_parallel);
+}
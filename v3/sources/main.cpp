@@ -1,9 +1,9 @@
 #include <iostream>
 #include <vector>
-#include <list>
 #include <numeric>
 
 #include "curves.hpp"
+#include "../../curves/reduce.hpp"
 
 int main()
 {
@@ -17,26 +17,12 @@ int main()
 	for (auto curve : first)
 		std::cout << "value(PI / 4) - {  " << curve->get_value(t) 
 			<< "}\nderivative(PI/4) - {  " << curve->get_d_dt_value(t) << "}" << "\n\n";
-	std::list<curves::circle*> second;
-	for (auto curve : first)
-	{
-		curves::circle* temp = dynamic_cast<curves::circle*>(curve.get());
-		if (temp != nullptr) second.push_back(temp);
-	}
-	second.sort([](const curves::circle* p1, const curves::circle* p2) 
-		{ return p1->get_radius() < p2->get_radius(); });
-	int sum_radius = 0;
-	int size = second.size();
-	auto it = second.begin();
-	#pragma omp parallel
+	// the circles are summed where they lie, without collecting them first
+	double sum_radius = curves::reduce::run(first.size(), [&first](std::size_t i)
 	{
-		#pragma omp for
-		for (int i = 0; i < size; ++i)
-		{
-			sum_radius += (*it)->get_radius();
-			++it;
-		}
-	}
+		const curves::circle* circle = dynamic_cast<const curves::circle*>(first[i].get());
+		return circle != nullptr ? circle->get_radius() : 0.0;
+	}, curves::reduce::DETERMINISTIC).sum;
 	std::cout << "Sum of circles radius: " << sum_radius << std::endl;
 
 	return 0;